@@ -0,0 +1,97 @@
+// Pi1541 - A Commodore 1541 disk drive emulator
+// Copyright(C) 2018 Stephen White
+//
+// This file is part of Pi1541.
+//
+// Pi1541 is free software : you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Pi1541 is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Pi1541. If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifndef BOOTTIMELINE_H
+#define BOOTTIMELINE_H
+
+#include <stdio.h>
+#include "defs.h"
+#include "types.h"
+#include "rpiHardware.h"
+extern "C"
+{
+#include "startup.h"
+}
+
+// Records when each boot step started and finished (and on which core) so the power on to ready time can be broken down.
+// The system timer starts counting when the Pi is powered on so the times include the GPU's boot and loading the kernel.
+// Each step is only written by the core running it.
+class BootTimeline
+{
+public:
+	enum
+	{
+		MAX_STEPS = 16
+	};
+
+	BootTimeline()
+	{
+		for (int step = 0; step < MAX_STEPS; ++step)
+			steps[step].name = 0;
+	}
+
+	void Begin(int step, const char* name)
+	{
+#if defined(HAS_MULTICORE)
+		steps[step].core = _get_core();
+#else
+		steps[step].core = 0;
+#endif
+		steps[step].start = steps[step].end = read32(ARM_SYSTIMER_CLO);
+		steps[step].name = name;
+	}
+
+	void End(int step)
+	{
+		steps[step].end = read32(ARM_SYSTIMER_CLO);
+	}
+
+	void Dump() const
+	{
+		u32 ready = 0;
+
+		printf("Boot timeline (ms since power on)\r\n");
+		for (int step = 0; step < MAX_STEPS; ++step)
+		{
+			const Step& s = steps[step];
+			if (s.name == 0)
+				continue;
+			printf("  %-16s core %u %6u.%03u - %6u.%03u (%u.%03u)\r\n", s.name, (unsigned)s.core
+				, (unsigned)(s.start / 1000), (unsigned)(s.start % 1000)
+				, (unsigned)(s.end / 1000), (unsigned)(s.end % 1000)
+				, (unsigned)((s.end - s.start) / 1000), (unsigned)((s.end - s.start) % 1000));
+			if (s.end > ready)
+				ready = s.end;
+		}
+		printf("  ready at %u.%03u\r\n", (unsigned)(ready / 1000), (unsigned)(ready % 1000));
+	}
+
+private:
+	struct Step
+	{
+		const char* volatile name;
+		u32 core;
+		volatile u32 start;
+		volatile u32 end;
+	};
+
+	Step steps[MAX_STEPS];
+};
+
+#endif
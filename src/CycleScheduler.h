@@ -0,0 +1,164 @@
+// Pi1541 - A Commodore 1541 disk drive emulator
+// Copyright(C) 2018 Stephen White
+//
+// This file is part of Pi1541.
+//
+// Pi1541 is free software : you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Pi1541 is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Pi1541. If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef CYCLESCHEDULER_H
+#define CYCLESCHEDULER_H
+
+#include "types.h"
+
+// Schedules the work in an emulation loop that does not have to be done on every emulated cycle.
+// Each event is given the number of cycles until it is next due and each cycle the loop only counts down to the earliest of them.
+// The chips (and the drive mechanics) that must be stepped every cycle keep their own next event internally;
+// they make the loop's events due through a CycleSchedulerSignal when something the loop shows changes (eg the LED).
+// There are only ever a handful of events so they are kept in a table that is scanned when one is due (rather than a heap).
+//
+// Usage;-
+//	if (scheduler.Tick())
+//	{
+//		int event;
+//		while ((event = scheduler.NextDue()) != CycleScheduler::NO_EVENT)
+//			... handle the event and Schedule() it again if it repeats
+//	}
+class CycleScheduler
+{
+public:
+	enum
+	{
+		MAX_EVENTS = 8,
+		NO_EVENT = -1
+	};
+
+	CycleScheduler()
+	{
+		Reset();
+	}
+
+	void Reset()
+	{
+		for (int event = 0; event < MAX_EVENTS; ++event)
+			active[event] = false;
+		base = 0;
+		span = countdown = IDLE_CYCLES;
+	}
+
+	// Advance one cycle. Returns true if an event is now due.
+	inline bool Tick()
+	{
+		return --countdown == 0;
+	}
+
+	// The cycle count since the scheduler was reset (wraps).
+	inline u32 Now() const
+	{
+		return base + (span - countdown);
+	}
+
+	// Make the event due cycles from now (cycles must be at least 1). An event already pending is moved.
+	void Schedule(int event, unsigned cycles)
+	{
+		u32 now = Now();
+
+		due[event] = now + cycles;
+		active[event] = true;
+
+		if (cycles < countdown)
+		{
+			base = now;
+			span = countdown = cycles;
+		}
+	}
+
+	void Cancel(int event)
+	{
+		active[event] = false;	// The countdown may still expire for it but nothing will be due then.
+	}
+
+	inline bool IsScheduled(int event) const
+	{
+		return active[event];
+	}
+
+	// Returns (and retires) the next event that is due, or NO_EVENT once they have all been handled.
+	int NextDue()
+	{
+		u32 now = Now();
+		unsigned next = IDLE_CYCLES;
+
+		for (int event = 0; event < MAX_EVENTS; ++event)
+		{
+			if (active[event])
+			{
+				int cycles = (int)(due[event] - now);
+				if (cycles <= 0)
+				{
+					active[event] = false;
+					return event;
+				}
+				if ((unsigned)cycles < next)
+					next = cycles;
+			}
+		}
+
+		// Nothing else is due; count down to the earliest event left.
+		base = now;
+		span = countdown = next;
+		return NO_EVENT;
+	}
+
+private:
+	enum
+	{
+		IDLE_CYCLES = 0x40000000	// Re-check this often when nothing is scheduled
+	};
+
+	u32 due[MAX_EVENTS];
+	bool active[MAX_EVENTS];
+
+	u32 base;		// Cycle the countdown was started on
+	u32 span;		// Length of the countdown
+	u32 countdown;	// Cycles until the earliest event is due
+};
+
+// Lets a chip or drive make one of an emulation loop's events due on the next cycle.
+class CycleSchedulerSignal
+{
+public:
+	CycleSchedulerSignal()
+		: scheduler(0)
+		, event(CycleScheduler::NO_EVENT)
+	{
+	}
+
+	void Connect(CycleScheduler* scheduler, int event)
+	{
+		this->scheduler = scheduler;
+		this->event = event;
+	}
+
+	inline void Signal()
+	{
+		if (scheduler)
+			scheduler->Schedule(event, 1);
+	}
+
+private:
+	CycleScheduler* scheduler;
+	int event;
+};
+
+#endif
@@ -37,6 +37,8 @@ static u32 redDark = RGBA(0x88, 0, 0, 0xff);
 static u32 redMid = RGBA(0xcc, 0, 0, 0xff);
 static u32 grey = RGBA(0x88, 0x88, 0x88, 0xff);
 static u32 greyDark = RGBA(0x44, 0x44, 0x44, 0xff);
+// Images are hashed a part at a time as they are read, while that part is still in the cache.
+static const u32 loadChunkSize = 64 * 1024;
 
 bool DiskCaddy::Empty()
 {
@@ -45,6 +47,8 @@ bool DiskCaddy::Empty()
 	int index;
 	bool anyDirty = false;
 
+	FinishInserts();
+
 #if not defined(EXPERIMENTALZERO)
 	if (screen)
 		screen->Clear(RGBA(0x40, 0x31, 0x8D, 0xFF));
@@ -52,7 +56,25 @@ bool DiskCaddy::Empty()
 
 	for (index = 0; index < (int)disks.size(); ++index)
 	{
-		if (disks[index]->IsDirty())
+		DiskImage* image = disks[index].image;
+		if (disks[index].packed)
+		{
+			// A compressed image only has to be opened up again if it has changes to save.
+			if (disks[index].packedDirty)
+			{
+				image = new DiskImage();
+				if (!image->Unpack(disks[index].packed))
+				{
+					delete image;
+					image = 0;
+				}
+			}
+			FreePacked(index);
+		}
+		if (image == 0)
+			continue;	// (images evicted to their file were saved when they were evicted)
+
+		if (image->IsDirty())
 		{
 			anyDirty = true;
 #if not defined(EXPERIMENTALZERO)
@@ -61,7 +83,7 @@ bool DiskCaddy::Empty()
 				x = screen->ScaleX(screenPosXCaddySelections);
 				y = screen->ScaleY(screenPosYCaddySelections);
 
-				snprintf(buffer, 256, "Saving %s", disks[index]->GetName());
+				snprintf(buffer, 256, "Saving %s", GetImageName(index));
 				screen->PrintText(false, x, y, buffer, RGBA(0xff, 0xff, 0xff, 0xff), red);
 			}
 #endif
@@ -75,13 +97,13 @@ bool DiskCaddy::Empty()
 				snprintf(buffer, 256, "Saving");
 				screenLCD->PrintText(false, x, y, buffer, RGBA(0xff, 0xff, 0xff, 0xff), BkColour);
 				y += screenLCD->GetFontHeight();
-				snprintf(buffer, 256, "%s                ", disks[index]->GetName());
+				snprintf(buffer, 256, "%s                ", GetImageName(index));
 				screenLCD->PrintText(false, x, y, buffer, RGBA(0xff, 0xff, 0xff, 0xff), red);
 				screenLCD->SwapBuffers();
 			}
 		}
-		disks[index]->Close();
-		delete disks[index];
+		image->Close();
+		delete image;
 	}
 
 	if (anyDirty)
@@ -113,22 +135,218 @@ bool DiskCaddy::Empty()
 	}
 
 	disks.clear();
+	residentImages = 0;
+	packedBytes = 0;
 	selectedIndex = 0;
 	oldCaddyIndex = 0;
 	return anyDirty;
 }
 
 bool DiskCaddy::Insert(const FILINFO* fileInfo, bool readOnly)
+{
+	MakeRoom(disks.size());
+
+	DiskImage* diskImage = Load(fileInfo, readOnly, true);
+	if (diskImage)
+	{
+		CaddyDisk disk;
+		disk.image = diskImage;
+		disk.packed = 0;
+		disk.packedSize = 0;
+		disk.packedDirty = false;
+		disk.fileInfo = fileInfo;
+		disk.readOnly = diskImage->GetReadOnly();
+		disk.isD81 = DiskImage::GetDiskImageTypeViaExtention(fileInfo->fname) == DiskImage::D81;
+		disk.lastUsed = ++useCount;
+		disks.push_back(disk);
+		residentImages++;
+		selectedIndex = disks.size() - 1;
+	}
+
+	oldCaddyIndex = 0;
+
+	return diskImage != 0;
+}
+
+DiskImage* DiskCaddy::GetImage(unsigned index)
+{
+	if (disks[index].image == 0)
+		MakeRoom(index);
+	return MakeResident(index);
+}
+
+void DiskCaddy::PrepareEmulating()
+{
+	FinishInserts();
+
+	// Outwards from the selected image, alternately after and before it, until the budget is full.
+	// The images already brought in are kept while making room for the next ones.
+	unsigned count = disks.size();
+	for (unsigned distance = 1; distance * 2 <= count; ++distance)
+	{
+		unsigned after = (selectedIndex + distance) % count;
+		unsigned before = (selectedIndex + count - distance) % count;
+
+		if (disks[after].image == 0)
+		{
+			if (!MakeRoom(after, distance + 1))
+				break;
+			MakeResident(after);
+		}
+		if (before != after && disks[before].image == 0)
+		{
+			if (!MakeRoom(before, distance + 1))
+				break;
+			MakeResident(before);
+		}
+	}
+}
+
+// Opens an evicted image again (unpacking it if it was compressed).
+DiskImage* DiskCaddy::MakeResident(unsigned index)
+{
+	CaddyDisk& disk = disks[index];
+
+	if (disk.image == 0)
+	{
+		if (disk.packed)
+		{
+			disk.image = new DiskImage();
+			if (!disk.image->Unpack(disk.packed))
+			{
+				delete disk.image;
+				disk.image = 0;
+			}
+			FreePacked(index);
+		}
+		if (disk.image == 0)
+			disk.image = Load(disk.fileInfo, disk.readOnly, false);
+		if (disk.image)
+			residentImages++;
+	}
+	FinishInserts();
+	disk.lastUsed = ++useCount;
+	return disk.image;
+}
+
+// Evicts the least recently used images until there is room in the budget for one more.
+// The images closer than keepDistance to the selected one (which may still be in the drive) and the one at keepIndex are never evicted.
+// Returns false if there is still no room.
+bool DiskCaddy::MakeRoom(unsigned keepIndex, unsigned keepDistance)
+{
+	while (residentImages * sizeof(DiskImage) + packedBytes + sizeof(DiskImage) > CADDY_MEMORY_BUDGET)
+	{
+		int evictIndex = -1;
+		bool evictSaves = false;
+		unsigned index;
+
+		// Images still being opened in the background cannot be looked at yet (only needed when one has to go).
+		FinishInserts();
+
+		for (index = 0; index < disks.size(); ++index)
+		{
+			DiskImage* image = disks[index].image;
+			if (image == 0 || index == keepIndex || Distance(index) < keepDistance)
+				continue;
+
+			// Changes that cannot be saved back into the image's file would be lost, unless compressing the image keeps them.
+			if (image->IsDirty() && !image->SavesInPlace() && !(compressImages && image->CanPack()))
+				continue;
+			// Otherwise the changes are saved before the image is compressed or closed.
+			bool saves = image->IsDirty() && image->SavesInPlace();
+
+			// Images that do not have to be saved first go before any that do.
+			if (evictIndex < 0 || (evictSaves && !saves) || (evictSaves == saves && disks[index].lastUsed < disks[evictIndex].lastUsed))
+			{
+				evictIndex = index;
+				evictSaves = saves;
+			}
+		}
+
+		if (evictIndex >= 0)
+		{
+			if (!Evict(evictIndex))
+				return false;
+			continue;
+		}
+
+		// Only compressed images are left to make room, those without changes can be opened from their file again.
+		for (index = 0; index < disks.size(); ++index)
+		{
+			if (disks[index].packed && !disks[index].packedDirty && index != keepIndex
+				&& (evictIndex < 0 || disks[index].lastUsed < disks[evictIndex].lastUsed))
+				evictIndex = index;
+		}
+
+		// Rather go over the budget than lose any changes.
+		if (evictIndex < 0)
+			return false;
+
+		FreePacked(evictIndex);
+	}
+	return true;
+}
+
+// Compressing or saving an image takes far too long for the emulation loop so this is only reached from Insert(),
+// GetImage() and PrepareEmulating(); the loop only swaps between images that are already in memory.
+// Returns false if the image had to stay.
+bool DiskCaddy::Evict(unsigned index)
+{
+	CaddyDisk& disk = disks[index];
+	DiskImage* image = disk.image;
+
+	if (compressImages && image->CanPack())
+	{
+		// Saved now rather than when the caddy is emptied, so the changes are not lost if the Pi is switched off.
+		// (Those that cannot be saved back into the image's file stay in the compressed copy.)
+		image->Save();
+		disk.packed = image->Pack(disk.packedSize);
+		if (disk.packed)
+		{
+			DEBUG_LOG("Compressed %s in caddy to %d bytes\r\n", GetImageName(index), disk.packedSize);
+			disk.packedDirty = image->IsDirty();
+			packedBytes += disk.packedSize;
+			delete image;
+			disk.image = 0;
+			residentImages--;
+			return true;
+		}
+
+		// Without the memory to compress it the image has to be closed after all.
+		if (image->IsDirty() && !image->SavesInPlace())
+			return false;
+	}
+
+	DEBUG_LOG("Evicting %s from caddy\r\n", GetImageName(index));
+	image->Close();	// (saves it if it has been written to)
+	delete image;
+	disk.image = 0;
+	residentImages--;
+	return true;
+}
+
+void DiskCaddy::FreePacked(unsigned index)
+{
+	free(disks[index].packed);
+	disks[index].packed = 0;
+	packedBytes -= disks[index].packedSize;
+	disks[index].packedSize = 0;
+	disks[index].packedDirty = false;
+}
+
+// Inserting shows the disk being loaded and lets a D64 be converted on a job core while the next disk is read.
+// Otherwise (opening an evicted image again) it is all done before this returns.
+DiskImage* DiskCaddy::Load(const FILINFO* fileInfo, bool readOnly, bool inserting)
 {
 	int x;
 	int y;
-	bool success;
+	DiskImage* diskImage;
 	FIL fp;
 	FRESULT res = f_open(&fp, fileInfo->fname, FA_READ);
 	if (res == FR_OK)
 	{
 #if not defined(EXPERIMENTALZERO)
-		if (screen)
+		if (inserting && screen)
 		{
 			x = screen->ScaleX(screenPosXCaddySelections);
 			y = screen->ScaleY(screenPosYCaddySelections);
@@ -141,7 +359,7 @@ bool DiskCaddy::Insert(const FILINFO* fileInfo, bool readOnly)
 		}
 #endif
 
-		if (screenLCD)
+		if (inserting && screenLCD)
 		{
 			RGBA BkColour = RGBA(0, 0, 0, 0xFF);
 			screenLCD->Clear(BkColour);
@@ -155,9 +373,23 @@ bool DiskCaddy::Insert(const FILINFO* fileInfo, bool readOnly)
 			screenLCD->PrintText(false, x, y, buffer, RGBA(0xff, 0xff, 0xff, 0xff), red);
 			screenLCD->SwapBuffers();
 		}
-		u32 bytesRead;
+		u32 bytesRead = 0;
+		u32 hash = HASH_BUFFER_START;
 		SetACTLed(true);
-		f_read(&fp, DiskImage::readBuffer, READBUFFER_SIZE, &bytesRead);
+		while (bytesRead < READBUFFER_SIZE)
+		{
+			u32 chunkSize = READBUFFER_SIZE - bytesRead;
+			u32 chunkRead;
+
+			if (chunkSize > loadChunkSize)
+				chunkSize = loadChunkSize;
+			if (f_read(&fp, DiskImage::readBuffer + bytesRead, chunkSize, &chunkRead) != FR_OK)
+				break;
+			hash = HashBuffer(DiskImage::readBuffer + bytesRead, chunkRead, hash);
+			bytesRead += chunkRead;
+			if (chunkRead < chunkSize)
+				break;
+		}
 		SetACTLed(false);
 		f_close(&fp);
 
@@ -165,145 +397,172 @@ bool DiskCaddy::Insert(const FILINFO* fileInfo, bool readOnly)
 		switch (diskType)
 		{
 			case DiskImage::D64:
-				success = InsertD64(fileInfo, (unsigned char*)DiskImage::readBuffer, bytesRead, readOnly);
+				diskImage = LoadD64(fileInfo, (unsigned char*)DiskImage::readBuffer, bytesRead, readOnly, hash, inserting);
 				break;
 			case DiskImage::G64:
-				success = InsertG64(fileInfo, (unsigned char*)DiskImage::readBuffer, bytesRead, readOnly);
+				diskImage = LoadG64(fileInfo, (unsigned char*)DiskImage::readBuffer, bytesRead, readOnly);
 				break;
 			case DiskImage::NIB:
-				success = InsertNIB(fileInfo, (unsigned char*)DiskImage::readBuffer, bytesRead, readOnly);
+				diskImage = LoadNIB(fileInfo, (unsigned char*)DiskImage::readBuffer, bytesRead, readOnly);
 				break;
 			case DiskImage::NBZ:
-				success = InsertNBZ(fileInfo, (unsigned char*)DiskImage::readBuffer, bytesRead, readOnly);
+				diskImage = LoadNBZ(fileInfo, (unsigned char*)DiskImage::readBuffer, bytesRead, readOnly);
 				break;
 			case DiskImage::D81:
-				success = InsertD81(fileInfo, (unsigned char*)DiskImage::readBuffer, bytesRead, readOnly);
+				diskImage = LoadD81(fileInfo, (unsigned char*)DiskImage::readBuffer, bytesRead, readOnly);
 				break;
 			case DiskImage::T64:
-				success = InsertT64(fileInfo, (unsigned char*)DiskImage::readBuffer, bytesRead, readOnly);
+				diskImage = LoadT64(fileInfo, (unsigned char*)DiskImage::readBuffer, bytesRead, readOnly);
 				break;
 			case DiskImage::PRG:
-				success = InsertPRG(fileInfo, (unsigned char*)DiskImage::readBuffer, bytesRead, readOnly);
+				diskImage = LoadPRG(fileInfo, (unsigned char*)DiskImage::readBuffer, bytesRead, readOnly);
 				break;
 			default:
-				success = false;
+				diskImage = 0;
 				break;
 		}
-		if (success)
+		if (diskImage)
 		{
-			DEBUG_LOG("Mounted into caddy %s - %d\r\n", fileInfo->fname, bytesRead);
+			// (a D64 may still be being opened in the background so it is given its hash once it has been)
+			if (diskType != DiskImage::D64)
+				diskImage->SetHash(hash);
+			DEBUG_LOG("Mounted into caddy %s - %d %08x\r\n", fileInfo->fname, bytesRead, hash);
 		}
 	}
 	else
 	{
 		DEBUG_LOG("Failed to open %s\r\n", fileInfo->fname);
-		success = false;
+		diskImage = 0;
 	}
 
-	oldCaddyIndex = 0;
+	return diskImage;
+}
 
-	return success;
+#if defined(BACKGROUND_JOBS)
+void DiskCaddy::OpenD64Job(void* param)
+{
+	PendingInsert* pending = (PendingInsert*)param;
+	pending->diskImage->OpenD64(pending->fileInfo, pending->diskImageData, pending->size);
+	pending->diskImage->SetHash(pending->hash);
 }
 
-bool DiskCaddy::InsertD64(const FILINFO* fileInfo, unsigned char* diskImageData, unsigned size, bool readOnly)
+void DiskCaddy::FinishPendingInserts()
+{
+	for (unsigned index = 0; index < pendingInserts.size(); ++index)
+	{
+		PendingInsert* pending = pendingInserts[index];
+		JobSystem::Wait(&pending->job);
+		free(pending->diskImageData);
+		delete pending;
+	}
+	pendingInserts.clear();
+}
+#endif
+
+DiskImage* DiskCaddy::LoadD64(const FILINFO* fileInfo, unsigned char* diskImageData, unsigned size, bool readOnly, u32 hash, bool inBackground)
 {
 	DiskImage* diskImage = new DiskImage();
+#if defined(BACKGROUND_JOBS)
+	// OpenD64() cannot fail so the disk can go into the caddy now and be converted while the next one is being read.
+	unsigned char* diskImageCopy = inBackground && JobSystem::GetNumberOfWorkers() ? (unsigned char*)malloc(size) : 0;
+	if (diskImageCopy)
+	{
+		PendingInsert* pending = new PendingInsert;
+		memcpy(diskImageCopy, diskImageData, size);
+		diskImage->SetReadOnly(readOnly);
+		pending->diskImage = diskImage;
+		pending->fileInfo = fileInfo;
+		pending->diskImageData = diskImageCopy;
+		pending->size = size;
+		pending->hash = hash;
+		pending->job = Job(OpenD64Job, pending);
+		pendingInserts.push_back(pending);
+		JobSystem::Submit(&pending->job);
+		return diskImage;
+	}
+#endif
 	if (diskImage->OpenD64(fileInfo, diskImageData, size))
 	{
+		diskImage->SetHash(hash);
 		diskImage->SetReadOnly(readOnly);
-		disks.push_back(diskImage);
-		selectedIndex = disks.size() - 1;
-		return true;
+		return diskImage;
 	}
 	delete diskImage;
-	return false;
+	return 0;
 }
 
-bool DiskCaddy::InsertG64(const FILINFO* fileInfo, unsigned char* diskImageData, unsigned size, bool readOnly)
+DiskImage* DiskCaddy::LoadG64(const FILINFO* fileInfo, unsigned char* diskImageData, unsigned size, bool readOnly)
 {
 	DiskImage* diskImage = new DiskImage();
 	if (diskImage->OpenG64(fileInfo, diskImageData, size))
 	{
 		diskImage->SetReadOnly(readOnly);
-		disks.push_back(diskImage);
-		//DEBUG_LOG("Disks size = %d\r\n", disks.size());
-		selectedIndex = disks.size() - 1;
-		return true;
+		return diskImage;
 	}
 	delete diskImage;
-	return false;
+	return 0;
 }
 
-bool DiskCaddy::InsertNIB(const FILINFO* fileInfo, unsigned char* diskImageData, unsigned size, bool readOnly)
+DiskImage* DiskCaddy::LoadNIB(const FILINFO* fileInfo, unsigned char* diskImageData, unsigned size, bool readOnly)
 {
 	DiskImage* diskImage = new DiskImage();
 	if (diskImage->OpenNIB(fileInfo, diskImageData, size))
 	{
 		// At the moment we cannot write out NIB files.
 		diskImage->SetReadOnly(true);// readOnly);
-		disks.push_back(diskImage);
-		selectedIndex = disks.size() - 1;
-		return true;
+		return diskImage;
 	}
 	delete diskImage;
-	return false;
+	return 0;
 }
 
-bool DiskCaddy::InsertNBZ(const FILINFO* fileInfo, unsigned char* diskImageData, unsigned size, bool readOnly)
+DiskImage* DiskCaddy::LoadNBZ(const FILINFO* fileInfo, unsigned char* diskImageData, unsigned size, bool readOnly)
 {
 	DiskImage* diskImage = new DiskImage();
 	if (diskImage->OpenNBZ(fileInfo, diskImageData, size))
 	{
 		// At the moment we cannot write out NIB files.
 		diskImage->SetReadOnly(true);// readOnly);
-		disks.push_back(diskImage);
-		selectedIndex = disks.size() - 1;
-		return true;
+		return diskImage;
 	}
 	delete diskImage;
-	return false;
+	return 0;
 }
 
-bool DiskCaddy::InsertD81(const FILINFO* fileInfo, unsigned char* diskImageData, unsigned size, bool readOnly)
+DiskImage* DiskCaddy::LoadD81(const FILINFO* fileInfo, unsigned char* diskImageData, unsigned size, bool readOnly)
 {
 	DiskImage* diskImage = new DiskImage();
 	if (diskImage->OpenD81(fileInfo, diskImageData, size))
 	{
 		diskImage->SetReadOnly(readOnly);
-		disks.push_back(diskImage);
-		selectedIndex = disks.size() - 1;
-		return true;
+		return diskImage;
 	}
 	delete diskImage;
-	return false;
+	return 0;
 }
 
-bool DiskCaddy::InsertT64(const FILINFO* fileInfo, unsigned char* diskImageData, unsigned size, bool readOnly)
+DiskImage* DiskCaddy::LoadT64(const FILINFO* fileInfo, unsigned char* diskImageData, unsigned size, bool readOnly)
 {
 	DiskImage* diskImage = new DiskImage();
 	if (diskImage->OpenT64(fileInfo, diskImageData, size))
 	{
 		diskImage->SetReadOnly(readOnly);
-		disks.push_back(diskImage);
-		selectedIndex = disks.size() - 1;
-		return true;
+		return diskImage;
 	}
 	delete diskImage;
-	return false;
+	return 0;
 }
 
-bool DiskCaddy::InsertPRG(const FILINFO* fileInfo, unsigned char* diskImageData, unsigned size, bool readOnly)
+DiskImage* DiskCaddy::LoadPRG(const FILINFO* fileInfo, unsigned char* diskImageData, unsigned size, bool readOnly)
 {
 	DiskImage* diskImage = new DiskImage();
 	if (diskImage->OpenPRG(fileInfo, diskImageData, size))
 	{
 		diskImage->SetReadOnly(readOnly);
-		disks.push_back(diskImage);
-		selectedIndex = disks.size() - 1;
-		return true;
+		return diskImage;
 	}
 	delete diskImage;
-	return false;
+	return 0;
 }
 
 void DiskCaddy::Display()
@@ -326,30 +585,81 @@ void DiskCaddy::Display()
 
 		for (caddyIndex = 0; caddyIndex < numberOfImages; ++caddyIndex)
 		{
-			DiskImage* image = GetImage(caddyIndex);
-			if (image)
+			const char* name = GetImageName(caddyIndex);
+			if (name)
 			{
-				const char* name = image->GetName();
-				if (name)
-				{
-					snprintf(buffer, 256, "                                                        ");
-					screen->PrintText(false, x, y, buffer, grey, greyDark);
-					snprintf(buffer, 256, "  %d %s", caddyIndex + 1, name);
-					screen->PrintText(false, x, y, buffer, grey, greyDark);
-					y += 16;
-				}
+				snprintf(buffer, 256, "                                                        ");
+				screen->PrintText(false, x, y, buffer, grey, greyDark);
+				snprintf(buffer, 256, "  %d %s", caddyIndex + 1, name);
+				screen->PrintText(false, x, y, buffer, grey, greyDark);
+				y += 16;
 			}
 		}
 	}
+#endif
+#if defined(EXPERIMENTALZERO)
+	PrepareSelectionFrames();
 #endif
 	ShowSelectedImage(0);
+#if defined(EXPERIMENTALZERO)
+	oldCaddyIndex = 0;
+#endif
+}
+
+#if defined(EXPERIMENTALZERO)
+void DiskCaddy::PrepareSelectionFrames()
+{
+	unsigned numberOfImages = GetNumberOfImages();
+	unsigned caddyIndex;
+
+	free(selectionFrames);
+	selectionFrames = 0;
+	if (screenLCD == 0 || numberOfImages == 0)
+		return;
+
+	selectionFrameSize = screenLCD->GetFrameSize();
+	if (selectionFrameSize)
+		selectionFrames = (unsigned char*)malloc(selectionFrameSize * numberOfImages);
+	if (selectionFrames == 0)
+		return;
+
+	for (caddyIndex = 0; caddyIndex < numberOfImages; ++caddyIndex)
+	{
+		DrawSelectedImageLCD(caddyIndex);
+		screenLCD->SaveFrame(selectionFrames + caddyIndex * selectionFrameSize);
+	}
 }
 
+void DiskCaddy::UpdateEmulating()
+{
+	if (refreshingLCD)
+	{
+		if (!screenLCD->RefreshStep())
+			return;
+		refreshingLCD = false;
+	}
+
+	if (selectedIndex != oldCaddyIndex && selectionFrames)
+	{
+		oldCaddyIndex = selectedIndex;
+		screenLCD->BeginRefresh(selectionFrames + oldCaddyIndex * selectionFrameSize);
+		refreshingLCD = true;
+	}
+}
+
+void DiskCaddy::FinishEmulating()
+{
+	while (refreshingLCD)
+	{
+		if (screenLCD->RefreshStep())
+			refreshingLCD = false;
+	}
+}
+#endif
+
 void DiskCaddy::ShowSelectedImage(u32 index)
 {
-	DiskImage* image = GetImage(index);
-	
-	if (image == 0)
+	if (index >= disks.size())
 	{
 		return;
 	}
@@ -360,7 +670,7 @@ void DiskCaddy::ShowSelectedImage(u32 index)
 	{
 		x = screen->ScaleX(screenPosXCaddySelections);
 		y = screen->ScaleY(screenPosYCaddySelections) + 16 + 16 * index;
-		const char* name = image->GetName();
+		const char* name = GetImageName(index);
 		if (name)
 		{
 			snprintf(buffer, 256, "* %d %s", index + 1, name);
@@ -371,61 +681,64 @@ void DiskCaddy::ShowSelectedImage(u32 index)
 
 	if (screenLCD)
 	{
-		unsigned numberOfImages = GetNumberOfImages();
-		unsigned numberOfDisplayedImages = (screenLCD->Height()/screenLCD->GetFontHeight())-1;
-		unsigned caddyIndex;
-
-		RGBA BkColour = RGBA(0, 0, 0, 0xFF);
-		//screenLCD->Clear(BkColour);
-		x = 0;
-		y = 0;
-
-		snprintf(buffer, 256, "D%02d D%d/%d %c %s"
-			, deviceID
-			, index + 1
-			, numberOfImages
-			, GetImage(index)->GetReadOnly() ? 'R' : ' '
-			, roms ? (image->IsD81() ? roms->ROMName1581 : roms->GetSelectedROMName()) : ""
-			);
-		screenLCD->PrintText(false, x, y, buffer, 0, RGBA(0xff, 0xff, 0xff, 0xff));
-		y += screenLCD->GetFontHeight();
+		DrawSelectedImageLCD(index);
+		screenLCD->SwapBuffers();
+	}
+}
 
-		if (numberOfImages > numberOfDisplayedImages && index > numberOfDisplayedImages-1)
-		{
-			if (numberOfImages - index < numberOfDisplayedImages)
-				caddyIndex = numberOfImages - numberOfDisplayedImages;
-			else
-				caddyIndex = index;
-		}
+void DiskCaddy::DrawSelectedImageLCD(u32 index)
+{
+	u32 x;
+	u32 y;
+	unsigned numberOfImages = GetNumberOfImages();
+	unsigned numberOfDisplayedImages = (screenLCD->Height()/screenLCD->GetFontHeight())-1;
+	unsigned caddyIndex;
+
+	RGBA BkColour = RGBA(0, 0, 0, 0xFF);
+	//screenLCD->Clear(BkColour);
+	x = 0;
+	y = 0;
+
+	snprintf(buffer, 256, "D%02d D%d/%d %c %s"
+		, deviceID
+		, index + 1
+		, numberOfImages
+		, GetImageReadOnly(index) ? 'R' : ' '
+		, roms ? (IsImageD81(index) ? roms->ROMName1581 : roms->GetSelectedROMName()) : ""
+		);
+	screenLCD->PrintText(false, x, y, buffer, 0, RGBA(0xff, 0xff, 0xff, 0xff));
+	y += screenLCD->GetFontHeight();
+
+	if (numberOfImages > numberOfDisplayedImages && index > numberOfDisplayedImages-1)
+	{
+		if (numberOfImages - index < numberOfDisplayedImages)
+			caddyIndex = numberOfImages - numberOfDisplayedImages;
 		else
-		{
-			caddyIndex = 0;
-		}
+			caddyIndex = index;
+	}
+	else
+	{
+		caddyIndex = 0;
+	}
 
-		for (; caddyIndex < numberOfImages; ++caddyIndex)
+	for (; caddyIndex < numberOfImages; ++caddyIndex)
+	{
+		const char* name = GetImageName(caddyIndex);
+		if (name)
 		{
-			DiskImage* image = GetImage(caddyIndex);
-			if (image)
-			{
-				const char* name = image->GetName();
-				if (name)
-				{
-					memset(buffer, ' ', screenLCD->Width() / screenLCD->GetFontWidth());
-					screenLCD->PrintText(false, x, y, buffer, BkColour, BkColour);
-					snprintf(buffer, 256, "%d %s", caddyIndex + 1, name);
-					screenLCD->PrintText(false, x, y, buffer, 0, caddyIndex == index ? RGBA(0xff, 0xff, 0xff, 0xff) : BkColour);
-					y += screenLCD->GetFontHeight();
-				}
-				if (y >= screenLCD->Height())
-					break;
-			}
-		}
-		while (y < screenLCD->Height()) {
-			memset(buffer, ' ',  screenLCD->Width()/screenLCD->GetFontWidth());
+			memset(buffer, ' ', screenLCD->Width() / screenLCD->GetFontWidth());
 			screenLCD->PrintText(false, x, y, buffer, BkColour, BkColour);
+			snprintf(buffer, 256, "%d %s", caddyIndex + 1, name);
+			screenLCD->PrintText(false, x, y, buffer, 0, caddyIndex == index ? RGBA(0xff, 0xff, 0xff, 0xff) : BkColour);
 			y += screenLCD->GetFontHeight();
 		}
-		screenLCD->SwapBuffers();
+		if (y >= screenLCD->Height())
+			break;
+	}
+	while (y < screenLCD->Height()) {
+		memset(buffer, ' ',  screenLCD->Width()/screenLCD->GetFontWidth());
+		screenLCD->PrintText(false, x, y, buffer, BkColour, BkColour);
+		y += screenLCD->GetFontHeight();
 	}
 }
 
@@ -441,17 +754,13 @@ bool DiskCaddy::Update()
 		{
 			x = screen->ScaleX(screenPosXCaddySelections);
 			y = screen->ScaleY(screenPosYCaddySelections) + 16 + 16 * oldCaddyIndex;
-			DiskImage* image = GetImage(oldCaddyIndex);
-			if (image)
+			const char* name = GetImageName(oldCaddyIndex);
+			if (name)
 			{
-				const char* name = image->GetName();
-				if (name)
-				{
-					snprintf(buffer, 256, "                                                        ");
-					screen->PrintText(false, x, y, buffer, grey, greyDark);
-					snprintf(buffer, 256, "  %d %s", oldCaddyIndex + 1, name);
-					screen->PrintText(false, x, y, buffer, grey, greyDark);
-				}
+				snprintf(buffer, 256, "                                                        ");
+				screen->PrintText(false, x, y, buffer, grey, greyDark);
+				snprintf(buffer, 256, "  %d %s", oldCaddyIndex + 1, name);
+				screen->PrintText(false, x, y, buffer, grey, greyDark);
 			}
 		}
 #endif
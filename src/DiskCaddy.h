@@ -23,17 +23,36 @@
 #include "DiskImage.h"
 #include "Screen.h"
 #include "ROMs.h"
+#include "JobSystem.h"
+
+// The most memory the caddy keeps disk images in.
+// Beyond this the least recently selected images are compressed (see SetCompressImages()) or closed (saving them first
+// if they have been written to) and only their file is remembered; they are opened again when they are next selected.
+#if defined(RPI2) || defined(RPI3)
+#define CADDY_MEMORY_BUDGET (128 * 1024 * 1024)
+#else
+#define CADDY_MEMORY_BUDGET (32 * 1024 * 1024)
+#endif
 
 class DiskCaddy
 {
 public:
 	DiskCaddy()
 		: selectedIndex(0)
+		, residentImages(0)
+		, packedBytes(0)
+		, useCount(0)
+		, compressImages(false)
 #if not defined(EXPERIMENTALZERO)
 		, screen(0)
 #endif
 		, screenLCD(0)
 		, roms(0)
+#if defined(EXPERIMENTALZERO)
+		, selectionFrames(0)
+		, selectionFrameSize(0)
+		, refreshingLCD(false)
+#endif
 	{
 	}
 	void SetScreen(Screen* screen, ScreenBase* screenLCD, ROMs* roms)
@@ -45,80 +64,181 @@ public:
 		this->roms = roms;
 	}
 
+	// Keep the images that do not fit in the budget compressed in memory rather than opening them from their file again.
+	// GCR tracks are mostly sync and gap runs so several compressed images fit in the memory of one.
+	void SetCompressImages(bool compressImages) { this->compressImages = compressImages; }
+
 	bool Empty();
 
 	bool Insert(const FILINFO* fileInfo, bool readOnly);
 
+	// Selecting a disk (and the next/previous ones) only changes the index; the display catches up later (see Update()).
 	DiskImage* GetCurrentDisk()
 	{
-#if defined(EXPERIMENTALZERO)
-		Update();
-#endif
 		if (selectedIndex < disks.size())
-			return disks[selectedIndex];
+			return GetImage(selectedIndex);
 
 		return 0;
 	}
 
+	// Brings the images nearest the selected one (as many as fit in the budget) into memory before the emulation loop starts.
+	// The loop swaps disks with NextDisk(), PrevDisk() and SelectImage(), which never load anything; they return 0
+	// (and the selection stays) for an image that is not in memory.
+	void PrepareEmulating();
+
 	DiskImage* NextDisk()
 	{
-		selectedIndex = (selectedIndex + 1) % (u32)disks.size();
-		return GetCurrentDisk();
+		return Swap((selectedIndex + 1) % (u32)disks.size());
 	}
 
 	DiskImage* PrevDisk()
 	{
-		--selectedIndex;
-		if ((int)selectedIndex < 0)
-			selectedIndex += (u32)disks.size();
-		return GetCurrentDisk();
+		int index = (int)selectedIndex - 1;
+		if (index < 0)
+			index += (int)disks.size();
+		return Swap(index);
 	}
 
 	u32 GetNumberOfImages() const { return disks.size(); }
 	u32 GetSelectedIndex() const { return selectedIndex; }
 
-	DiskImage* GetImage(unsigned index) { return disks[index]; }
+	// Returns 0 if an evicted image can no longer be opened.
+	DiskImage* GetImage(unsigned index);
 	DiskImage* SelectImage(unsigned index)
 	{
 		if (selectedIndex != index && index < disks.size())
-		{
-			selectedIndex = index;
-			return GetCurrentDisk();
-		}
+			return Swap(index);
 		return 0;
 	}
 	DiskImage* SelectFirstImage()
 	{
 		if (disks.size())
-		{
-			selectedIndex = 0;
-			return GetCurrentDisk();
-		}
+			return Select(0);
 		return 0;
 	}
 
+	// These do not need the image to be in memory (so the display never causes one to be loaded).
+	const char* GetImageName(unsigned index) const { return disks[index].fileInfo->fname; }
+	bool GetImageReadOnly(unsigned index) const { return disks[index].readOnly; }
+	bool IsImageD81(unsigned index) const { return disks[index].isD81; }
+
 	void Display();
 	bool Update();
 
+#if defined(EXPERIMENTALZERO)
+	// Without another core to run Update() the emulation loop calls this regularly instead.
+	// The LCD display for every selection is drawn by Display() so this only has to send the selected one to the LCD,
+	// a few bytes each call. FinishEmulating() sends whatever is left once emulation stops.
+	void UpdateEmulating();
+	void FinishEmulating();
+#endif
+
 private:
-	bool InsertD64(const FILINFO* fileInfo, unsigned char* diskImageData, unsigned size, bool readOnly);
-	bool InsertG64(const FILINFO* fileInfo, unsigned char* diskImageData, unsigned size, bool readOnly);
-	bool InsertNIB(const FILINFO* fileInfo, unsigned char* diskImageData, unsigned size, bool readOnly);
-	bool InsertNBZ(const FILINFO* fileInfo, unsigned char* diskImageData, unsigned size, bool readOnly);
-	bool InsertD81(const FILINFO* fileInfo, unsigned char* diskImageData, unsigned size, bool readOnly);
-	bool InsertT64(const FILINFO* fileInfo, unsigned char* diskImageData, unsigned size, bool readOnly);
-	bool InsertPRG(const FILINFO* fileInfo, unsigned char* diskImageData, unsigned size, bool readOnly);
+	// An image in the caddy. Only image and packed change once the disk is in the caddy.
+	// While the disk is evicted image is 0, and packed holds it compressed (if it was) otherwise it is opened from its file again.
+	struct CaddyDisk
+	{
+		DiskImage* image;
+		unsigned char* packed;
+		u32 packedSize;
+		bool packedDirty;
+		const FILINFO* fileInfo;
+		bool readOnly;
+		bool isD81;
+		u32 lastUsed;
+	};
+
+	DiskImage* Select(unsigned index)
+	{
+		// The image being replaced is still in the drive until this returns so it must not be evicted to make room.
+		// If the new one cannot be opened the selection (and so the drive) keeps the old one.
+		DiskImage* diskImage = GetImage(index);
+		if (diskImage)
+			selectedIndex = index;
+		return diskImage;
+	}
+
+	DiskImage* Swap(unsigned index)
+	{
+		DiskImage* diskImage = disks[index].image;
+		if (diskImage)
+		{
+			selectedIndex = index;
+			disks[index].lastUsed = ++useCount;
+		}
+		return diskImage;
+	}
+
+	unsigned Distance(unsigned index) const
+	{
+		unsigned distance = index > selectedIndex ? index - selectedIndex : selectedIndex - index;
+		return distance * 2 > disks.size() ? disks.size() - distance : distance;
+	}
+
+	DiskImage* Load(const FILINFO* fileInfo, bool readOnly, bool inserting);
+	DiskImage* MakeResident(unsigned index);
+	bool MakeRoom(unsigned keepIndex, unsigned keepDistance = 1);
+	bool Evict(unsigned index);
+	void FreePacked(unsigned index);
+
+	DiskImage* LoadD64(const FILINFO* fileInfo, unsigned char* diskImageData, unsigned size, bool readOnly, u32 hash, bool inBackground);
+	DiskImage* LoadG64(const FILINFO* fileInfo, unsigned char* diskImageData, unsigned size, bool readOnly);
+	DiskImage* LoadNIB(const FILINFO* fileInfo, unsigned char* diskImageData, unsigned size, bool readOnly);
+	DiskImage* LoadNBZ(const FILINFO* fileInfo, unsigned char* diskImageData, unsigned size, bool readOnly);
+	DiskImage* LoadD81(const FILINFO* fileInfo, unsigned char* diskImageData, unsigned size, bool readOnly);
+	DiskImage* LoadT64(const FILINFO* fileInfo, unsigned char* diskImageData, unsigned size, bool readOnly);
+	DiskImage* LoadPRG(const FILINFO* fileInfo, unsigned char* diskImageData, unsigned size, bool readOnly);
 
 	void ShowSelectedImage(u32 index);
+	void DrawSelectedImageLCD(u32 index);
+#if defined(EXPERIMENTALZERO)
+	void PrepareSelectionFrames();
+#endif
+
+	// Disks still being opened in the background must be finished before they are looked at.
+	inline void FinishInserts()
+	{
+#if defined(BACKGROUND_JOBS)
+		if (pendingInserts.size())
+			FinishPendingInserts();
+#endif
+	}
 
-	std::vector<DiskImage*> disks;
+#if defined(BACKGROUND_JOBS)
+	// A D64 being converted to GCR on one of the job cores while the next disk is read from the SD card.
+	struct PendingInsert
+	{
+		Job job;
+		DiskImage* diskImage;
+		const FILINFO* fileInfo;
+		unsigned char* diskImageData;	// A copy as DiskImage::readBuffer is reused by the next Insert()
+		unsigned size;
+		u32 hash;
+	};
+
+	static void OpenD64Job(void* param);
+	void FinishPendingInserts();
+
+	std::vector<PendingInsert*> pendingInserts;
+#endif
+
+	std::vector<CaddyDisk> disks;
 	u32 selectedIndex;
+	u32 residentImages;
+	u32 packedBytes;
+	u32 useCount;
+	bool compressImages;
 	u32 oldCaddyIndex;
 #if not defined(EXPERIMENTALZERO)
 	ScreenBase* screen;
 #endif
 	ScreenBase* screenLCD;
 	ROMs* roms;
+#if defined(EXPERIMENTALZERO)
+	unsigned char* selectionFrames;	// The LCD frame for each selection (selectionFrameSize bytes each)
+	u32 selectionFrameSize;
+	bool refreshingLCD;
+#endif
 };
 
 #endif
\ No newline at end of file
@@ -32,8 +32,6 @@ extern "C"
 #include "rpi-gpio.h"
 }
 
-extern u32 HashBuffer(const void* pBuffer, u32 length);
-
 #define MAX_DIRECTORY_SECTORS 18
 #define DIRECTORY_SIZE 32
 #define DISK_SECTOR_OFFSET_FIRST_DIRECTORY_SECTOR 357
@@ -137,6 +135,29 @@ unsigned DiskImage::SectorsPerTrackD64(unsigned track)
 
 #define NIB_HEADER_SIZE 0xFF
 
+// Hash chain candidates examined per position when compressing NBZ images.
+// Higher values squeeze a little more out of the image but take longer to save.
+#define NBZ_COMPRESSION_EFFORT 16
+// Images are packed as the caddy is filled and before emulation starts (never while emulating, see DiskCaddy::PrepareEmulating()).
+// A low effort keeps inserting a large caddy quick; the sync and gap runs compress well at any effort.
+#define PACK_COMPRESSION_EFFORT 4
+
+// What Pack() keeps of an image along with its compressed tracks (which follow in track order).
+struct PackedImage
+{
+	const FILINFO* fileInfo;
+	DiskImage::DiskType diskType;
+	unsigned attachedImageSize;
+	unsigned hash;
+	bool readOnly;
+	bool dirty;
+	unsigned short trackLengths[HALF_TRACK_COUNT];
+	unsigned short packedLengths[HALF_TRACK_COUNT];
+	unsigned char trackDensity[HALF_TRACK_COUNT];
+	bool trackDirty[HALF_TRACK_COUNT];
+	bool trackUsed[HALF_TRACK_COUNT];
+};
+
 int gap_match_length = 7;	// Used by gcr.cpp
 
 DiskImage::DiskImage()
@@ -192,6 +213,115 @@ void DiskImage::Close()
 	hash = 0;
 }
 
+bool DiskImage::Save()
+{
+	bool saved;
+
+	if (!dirty || !SavesInPlace())
+		return !dirty;
+
+	switch (diskType)
+	{
+		case D64:
+			saved = WriteD64();
+		break;
+		case G64:
+			saved = WriteG64();
+		break;
+		default:
+			saved = WriteD81();
+		break;
+	}
+	if (saved)
+		dirty = false;
+	return saved;
+}
+
+unsigned char* DiskImage::Pack(u32& size)
+{
+	PackedImage header;
+	unsigned track;
+	u32 packedSize = 0;
+
+	if (!CanPack())
+		return 0;
+
+	header.fileInfo = fileInfo;
+	header.diskType = diskType;
+	header.attachedImageSize = attachedImageSize;
+	header.hash = hash;
+	header.readOnly = readOnly;
+	header.dirty = dirty;
+	memcpy(header.trackLengths, trackLengths, sizeof(trackLengths));
+	memcpy(header.trackDensity, trackDensity, sizeof(header.trackDensity));
+	memcpy(header.trackDirty, trackDirty, sizeof(trackDirty));
+	memcpy(header.trackUsed, trackUsed, sizeof(trackUsed));
+
+	// Only the bytes inside each track's length are ever read so they are all that is kept.
+	for (track = 0; track < HALF_TRACK_COUNT; ++track)
+	{
+		unsigned length = trackLengths[track];
+		unsigned packedLength = 0;
+
+		if (length)
+		{
+			// (the worst case for incompressible data)
+			if (packedSize + length + (length >> 8) + 1 > sizeof(compressionBuffer))
+				return 0;
+			packedLength = LZ_CompressHash((unsigned char*)tracks + track * MAX_TRACK_LENGTH, compressionBuffer + packedSize, length, PACK_COMPRESSION_EFFORT);
+			if (packedLength == 0)
+				return 0;
+		}
+		header.packedLengths[track] = packedLength;
+		packedSize += packedLength;
+	}
+
+	unsigned char* packed = (unsigned char*)malloc(sizeof(header) + packedSize);
+	if (packed)
+	{
+		memcpy(packed, &header, sizeof(header));
+		memcpy(packed + sizeof(header), compressionBuffer, packedSize);
+		size = sizeof(header) + packedSize;
+	}
+	return packed;
+}
+
+bool DiskImage::Unpack(const unsigned char* packed)
+{
+	const PackedImage* header = (const PackedImage*)packed;
+	unsigned char* packedTrack = (unsigned char*)packed + sizeof(PackedImage);
+	unsigned track;
+
+	// Each track is only written once: what was packed is decompressed and the rest is filled as Close() leaves it.
+	for (track = 0; track < HALF_TRACK_COUNT; ++track)
+	{
+		unsigned char* trackData = (unsigned char*)tracks + track * MAX_TRACK_LENGTH;
+		unsigned packedLength = header->packedLengths[track];
+		unsigned length = 0;
+
+		if (packedLength)
+		{
+			length = header->trackLengths[track];
+			if (LZ_UncompressFast(packedTrack, trackData, packedLength) != (int)length)
+				return false;
+			packedTrack += packedLength;
+		}
+		memset(trackData + length, 0x55, MAX_TRACK_LENGTH - length);
+	}
+
+	fileInfo = header->fileInfo;
+	diskType = header->diskType;
+	attachedImageSize = header->attachedImageSize;
+	hash = header->hash;
+	readOnly = header->readOnly;
+	dirty = header->dirty;
+	memcpy(trackLengths, header->trackLengths, sizeof(trackLengths));
+	memcpy(trackDensity, header->trackDensity, sizeof(header->trackDensity));
+	memcpy(trackDirty, header->trackDirty, sizeof(trackDirty));
+	memcpy(trackUsed, header->trackUsed, sizeof(trackUsed));
+	return true;
+}
+
 void DiskImage::DumpTrack(unsigned track)
 {
 
@@ -857,8 +987,6 @@ bool DiskImage::OpenG64(const FILINFO* fileInfo, unsigned char* diskImage, unsig
 
 	if (memcmp(diskImage, "GCR-1541", 8) == 0)
 	{
-		hash = HashBuffer(diskImage, size);
-
 		//DEBUG_LOG("Is G64 %08x\r\n", hash);
 
 		unsigned char numTracks = diskImage[9];
@@ -1037,6 +1165,29 @@ void DiskImage::CloseG64()
 	attachedImageSize = 0;
 }
 
+void DiskImage::ExtractNIBTrack(int track, unsigned char* nibdata)
+{
+	int align;
+
+	DEBUG_LOG("Converting NIB track %d (%d.%d)\r\n", track, track >> 1, track & 1 ? 5 : 0);
+
+#if defined(EXPERIMENTALZERO)
+	trackLengths[track] = extract_GCR_track(&tracks[track << 13], nibdata, &align
+		//, ALIGN_GAP
+		, ALIGN_NONE
+		, capacity_min[trackDensity[track]],
+		capacity_max[trackDensity[track]]);
+#else
+	trackLengths[track] = extract_GCR_track(tracks[track], nibdata, &align
+		//, ALIGN_GAP
+		, ALIGN_NONE
+		, capacity_min[trackDensity[track]],
+		capacity_max[trackDensity[track]]);
+#endif
+
+	trackUsed[track] = true;
+}
+
 bool DiskImage::OpenNIB(const FILINFO* fileInfo, unsigned char* diskImage, unsigned size)
 {
 	int track, t_index = 0, h_index = 0;
@@ -1061,25 +1212,8 @@ bool DiskImage::OpenNIB(const FILINFO* fileInfo, unsigned char* diskImage, unsig
 			unsigned char v = diskImage[0x11 + h_index];
 			trackDensity[track] = (v & 0x03);
 
-			DEBUG_LOG("Converting NIB track %d (%d.%d)\r\n", track, track >> 1, track & 1 ? 5 : 0);
-
 			unsigned char* nibdata = diskImage + (t_index * NIB_TRACK_LENGTH) + 0x100;
-			int align;
-#if defined(EXPERIMENTALZERO)
-			trackLengths[track] = extract_GCR_track(&tracks[track << 13], nibdata, &align
-				//, ALIGN_GAP
-				, ALIGN_NONE
-				, capacity_min[trackDensity[track]],
-				capacity_max[trackDensity[track]]);
-#else
-			trackLengths[track] = extract_GCR_track(tracks[track], nibdata, &align
-				//, ALIGN_GAP
-				, ALIGN_NONE
-				, capacity_min[trackDensity[track]],
-				capacity_max[trackDensity[track]]);
-#endif
-
-			trackUsed[track] = true;
+			ExtractNIBTrack(track, nibdata);
 
 			h_index += 2;
 			t_index++;
@@ -1105,51 +1239,14 @@ bool DiskImage::WriteNIB()
 		u32 bytesToWrite;
 		u32 bytesWritten;
 
-		int track;
-		char header[0x100];
-		int header_entry = 0;
-
 		DEBUG_LOG("Converting to NIB format...\n");
 
-		memset(header, 0, sizeof(header));
-
-		sprintf(header, "MNIB-1541-RAW%c%c%c", 1, 0, 0);
-
-		for (track = 0; track < (MAX_TRACKS_1541 * 2); ++track)
-		{
-			if (trackUsed[track])
-			{
-				header[0x10 + (header_entry * 2)] = (BYTE)track + 2;
-				header[0x10 + (header_entry * 2) + 1] = trackDensity[track];
-
-				header_entry++;
-			}
-		}
-
-		bytesToWrite = sizeof(header);
+		bytesToWrite = BuildNIB(readBuffer);
 		SetACTLed(true);
-		if (f_write(&fp, header, bytesToWrite, &bytesWritten) != FR_OK || bytesToWrite != bytesWritten)
+		if (f_write(&fp, readBuffer, bytesToWrite, &bytesWritten) != FR_OK || bytesToWrite != bytesWritten)
 		{
 			DEBUG_LOG("Cannot write track data.\r\n");
 		}
-		else
-		{
-			bytesToWrite = NIB_TRACK_LENGTH;
-			for (track = 0; track < HALF_TRACK_COUNT; ++track)
-			{
-				if (trackUsed[track])
-				{
-#if defined(EXPERIMENTALZERO)
-					if (f_write(&fp, &tracks[track << 13], bytesToWrite, &bytesWritten) != FR_OK || bytesToWrite != bytesWritten)
-#else
-					if (f_write(&fp, tracks[track], bytesToWrite, &bytesWritten) != FR_OK || bytesToWrite != bytesWritten)
-#endif
-					{
-						DEBUG_LOG("Cannot write track data.\r\n");
-					}
-				}
-			}
-		}
 		SetACTLed(false);
 
 		f_close(&fp);
@@ -1176,19 +1273,114 @@ void DiskImage::CloseNIB()
 	attachedImageSize = 0;
 }
 
+// The size of the NIB the header describes (the header and one block per listed track).
+static unsigned NIBImageSize(const unsigned char* header)
+{
+	int h_index = 0;
+
+	while ((0x11 + h_index) < NIB_HEADER_SIZE + 1 && header[0x10 + h_index])
+		h_index += 2;
+	return 0x100 + (h_index >> 1) * NIB_TRACK_LENGTH;
+}
+
+// The NIB inside an NBZ is decompressed one track at a time straight into extract_GCR_track.
+// Only the LZ history window and the current NIB track are ever held in memory.
 bool DiskImage::OpenNBZ(const FILINFO* fileInfo, unsigned char* diskImage, unsigned size)
 {
+	LZ_Stream stream;
+	unsigned char header[NIB_HEADER_SIZE + 1];
+	unsigned char* window = compressionBuffer;
+	unsigned char* nibdata = compressionBuffer + LZ_WINDOW_SIZE;
+	int track, h_index = 0;
+
 	Close();
 
-	if ((size = LZ_Uncompress(diskImage, compressionBuffer, size)))
+	LZ_UncompressStreamInit(&stream, diskImage, size, window);
+	if (LZ_UncompressStream(&stream, header, sizeof(header)) != sizeof(header) || memcmp(header, "MNIB-1541-RAW", 13) != 0)
+		return false;
+
+	this->fileInfo = fileInfo;
+
+	attachedImageSize = size;
+
+	for (track = 0; track < (MAX_TRACKS_1541 * 2); ++track)
+	{
+		trackLengths[track] = capacity_max[trackDensity[track]];
+		trackUsed[track] = false;
+	}
+
+	while ((0x11 + h_index) < (int)sizeof(header) && header[0x10 + h_index])
+	{
+		if (LZ_UncompressStream(&stream, nibdata, NIB_TRACK_LENGTH) != NIB_TRACK_LENGTH)
+		{
+			if (stream.error)
+				break;
+			// The stream ran out before every track the header lists.
+			DEBUG_LOG("NBZ is truncated\r\n");
+			Close();
+			return false;
+		}
+
+		track = header[0x10 + h_index] - 2;
+		trackDensity[track] = (header[0x11 + h_index] & 0x03);
+		ExtractNIBTrack(track, nibdata);
+
+		h_index += 2;
+	}
+
+	if (stream.error)
 	{
-		if (OpenNIB(fileInfo, compressionBuffer, size))
+		// Compressed with a larger history than the stream window holds so fall back to the whole image.
+		DEBUG_LOG("NBZ offset exceeds stream window\r\n");
+		size = LZ_UncompressFast(diskImage, compressionBuffer, size);
+		if (size >= NIBImageSize(header) && OpenNIB(fileInfo, compressionBuffer, size))
 		{
-			diskType = NIB;
+			diskType = NBZ;
 			return true;
 		}
+		Close();
+		return false;
 	}
-	return false;
+
+	DEBUG_LOG("Successfully parsed NBZ data for %d tracks\n", h_index >> 1);
+	diskType = NBZ;
+	return true;
+}
+
+// Lays out the image as a NIB (the header followed by each used track) for WriteNIB and WriteNBZ.
+unsigned DiskImage::BuildNIB(unsigned char* dest)
+{
+	int track;
+	int header_entry = 0;
+	unsigned char* data = dest + 0x100;
+
+	memset(dest, 0, 0x100);
+	sprintf((char*)dest, "MNIB-1541-RAW%c%c%c", 1, 0, 0);
+
+	for (track = 0; track < (MAX_TRACKS_1541 * 2); ++track)
+	{
+		if (trackUsed[track])
+		{
+			dest[0x10 + (header_entry * 2)] = (BYTE)track + 2;
+			dest[0x10 + (header_entry * 2) + 1] = trackDensity[track];
+
+			header_entry++;
+		}
+	}
+
+	for (track = 0; track < HALF_TRACK_COUNT; ++track)
+	{
+		if (trackUsed[track])
+		{
+#if defined(EXPERIMENTALZERO)
+			memcpy(data, &tracks[track << 13], NIB_TRACK_LENGTH);
+#else
+			memcpy(data, tracks[track], NIB_TRACK_LENGTH);
+#endif
+			data += NIB_TRACK_LENGTH;
+		}
+	}
+	return data - dest;
 }
 
 bool DiskImage::WriteNBZ()
@@ -1199,37 +1391,29 @@ bool DiskImage::WriteNBZ()
 		return true;
 
 	SetACTLed(true);
-	if (WriteNIB())
+	// Compress the NIB straight from memory rather than writing it out and reading it back.
+	unsigned size = BuildNIB(readBuffer);
+	u32 bytesCompressed = LZ_CompressHash(readBuffer, compressionBuffer, size, NBZ_COMPRESSION_EFFORT);
+	DEBUG_LOG("Compressed %s - %d to %d\r\n", fileInfo->fname, size, bytesCompressed);
+
+	if (bytesCompressed)
 	{
 		FIL fp;
-		FRESULT res = f_open(&fp, fileInfo->fname, FA_READ);
+		FRESULT res = f_open(&fp, fileInfo->fname, FA_CREATE_ALWAYS | FA_WRITE);
 		if (res == FR_OK)
 		{
-			u32 bytesRead;
-			f_read(&fp, readBuffer, READBUFFER_SIZE, &bytesRead);
-			f_close(&fp);
-			DEBUG_LOG("Reloaded %s - %d for compression\r\n", fileInfo->fname, bytesRead);
-			bytesRead = LZ_Compress(readBuffer, compressionBuffer, bytesRead);
+			u32 bytesToWrite = bytesCompressed;
+			u32 bytesWritten;
 
-			if (bytesRead)
+			if (f_write(&fp, compressionBuffer, bytesToWrite, &bytesWritten) != FR_OK || bytesToWrite != bytesWritten)
 			{
-				res = f_open(&fp, fileInfo->fname, FA_CREATE_ALWAYS | FA_WRITE);
-				if (res == FR_OK)
-				{
-					u32 bytesToWrite = bytesRead;
-					u32 bytesWritten;
-
-					if (f_write(&fp, compressionBuffer, bytesToWrite, &bytesWritten) != FR_OK || bytesToWrite != bytesWritten)
-					{
-						DEBUG_LOG("Cannot write NBZ data.\r\n");
-					}
-					else
-					{
-						success = true;
-					}
-					f_close(&fp);
-				}
+				DEBUG_LOG("Cannot write NBZ data.\r\n");
 			}
+			else
+			{
+				success = true;
+			}
+			f_close(&fp);
 		}
 	}
 	SetACTLed(false);
@@ -42,6 +42,10 @@ static const unsigned short G64_MAX_TRACK_LENGTH = 7928;
 
 static const unsigned short D81_SECTOR_LENGTH = 512;
 
+// FNV-1a (see main.cpp). Pass the result for the data so far back in as hash to carry on over the next part of it.
+#define HASH_BUFFER_START 0x811c9dc5U
+extern u32 HashBuffer(const void* pBuffer, u32 length, u32 hash = HASH_BUFFER_START);
+
 class DiskImage
 {
 public:
@@ -75,6 +79,12 @@ public:
 
 	void Close();
 
+	// Compresses the tracks (each on its own) into a malloc'd block that Unpack() turns back into this image, changes and all.
+	// The image is left as it was. Returns 0 if it cannot be packed (D71 and D81 images are not GCR) or there is not the memory.
+	unsigned char* Pack(u32& size);
+	bool Unpack(const unsigned char* packed);
+	bool CanPack() const { return attachedImageSize != 0 && diskType != D71 && diskType != D81; }
+
 	bool GetDecodedSector(u32 track, u32 sector, u8* buffer);
 
 	inline unsigned char GetNextByte(u32 track, u32 byte)
@@ -182,6 +192,10 @@ public:
 	unsigned LastTrackUsed();
 
 	bool IsDirty() const { return dirty; }
+	// Whether Close() saves the changes back into the file the image was opened from (so opening that again gets them back).
+	bool SavesInPlace() const { return !readOnly && (diskType == D64 || diskType == G64 || diskType == D81); }
+	// Saves the changes (if it can, see SavesInPlace()) and keeps the image open. Returns false if they are still only in memory.
+	bool Save();
 
 	static unsigned char readBuffer[READBUFFER_SIZE];
 
@@ -200,7 +214,9 @@ public:
 	bool WriteD64(char* name = 0);
 	bool WriteG64(char* name = 0);
 
+	// The hash of the image file (set by whoever read it, see DiskCaddy::Load()).
 	unsigned GetHash() const { return hash; }
+	void SetHash(unsigned hash) { this->hash = hash; }
 
 	inline static unsigned GetSpeedZoneIndexD64(unsigned track)
 	{
@@ -219,6 +235,7 @@ private:
 	void CloseT64();
 
 	bool WriteNIB();
+	unsigned BuildNIB(unsigned char* dest);
 	bool WriteNBZ();
 	bool WriteD71();
 	bool WriteD81();
@@ -234,6 +251,8 @@ private:
 		}
 	}
 
+	void ExtractNIBTrack(int track, unsigned char* nibdata);
+
 	bool ConvertSector(unsigned track, unsigned sector, unsigned char* buffer);
 	void DecodeBlock(unsigned track, int bitIndex, unsigned char* buf, int num);
 	unsigned GetID(unsigned track, unsigned char* id);
@@ -20,16 +20,6 @@
 #include "m6522.h"
 #include "debug.h"
 
-
-//#define PROFILE 1
-
-#if defined(PROFILE)
-extern "C"
-{
-#include "performance.h"
-}
-#endif
-
 // There is a lot going on even though the emulation code is extremely small.
 // A few counters, shift registers and the occasional logic gate takes a surprisingly small amount of code to implement.
 
@@ -394,6 +384,65 @@ void Drive::Eject()
 	if (diskImage) diskImage = 0;
 }
 
+void Drive::SaveState(Snapshot& snapshot) const
+{
+	snapshot.Write(newDiskImageQueuedCylesRemaining);
+#if defined(EXPERIMENTALZERO)
+	snapshot.Write(localSeed);
+	snapshot.Write(cyclesLeftForBit);
+	snapshot.Write(fluxReversalCyclesLeft);
+	snapshot.Write(cyclesForBitErrorCounter);
+#endif
+	snapshot.Write(UE7Counter);
+	snapshot.Write(writeShiftRegister);
+	snapshot.Write(cyclesForBit);
+	snapshot.Write(readShiftRegister);
+	snapshot.Write(headTrackPos);
+	snapshot.Write(headBitOffset);
+	snapshot.Write(randomFluxReversalTime);
+	snapshot.Write(UF4Counter);
+	snapshot.Write(UE3Counter);
+	snapshot.Write(CLOCK_SEL_AB);
+	snapshot.Write(SO);
+	snapshot.Write(lastHeadDirection);
+	snapshot.Write(motor);
+	snapshot.Write(LED);
+}
+
+void Drive::LoadState(Snapshot& snapshot)
+{
+	snapshot.Read(newDiskImageQueuedCylesRemaining);
+#if defined(EXPERIMENTALZERO)
+	unsigned int bitErrorCounter;
+	snapshot.Read(localSeed);
+	snapshot.Read(cyclesLeftForBit);
+	snapshot.Read(fluxReversalCyclesLeft);
+	snapshot.Read(bitErrorCounter);
+#endif
+	snapshot.Read(UE7Counter);
+	snapshot.Read(writeShiftRegister);
+	snapshot.Read(cyclesForBit);
+	snapshot.Read(readShiftRegister);
+	snapshot.Read(headTrackPos);
+	snapshot.Read(headBitOffset);
+	snapshot.Read(randomFluxReversalTime);
+	snapshot.Read(UF4Counter);
+	snapshot.Read(UE3Counter);
+	snapshot.Read(CLOCK_SEL_AB);
+	snapshot.Read(SO);
+	snapshot.Read(lastHeadDirection);
+	snapshot.Read(motor);
+	snapshot.Read(LED);
+
+	// The track lengths come from the disk image.
+	if (diskImage)
+		UpdateHeadSectorPosition();
+#if defined(EXPERIMENTALZERO)
+	cyclesForBitErrorCounter = bitErrorCounter;
+#endif
+	cachedbyteOffset = -1;
+}
+
 void Drive::DumpTrack(unsigned track)
 {
 	if (diskImage) diskImage->DumpTrack(track);
@@ -403,42 +452,19 @@ void Drive::DumpTrack(unsigned track)
 void Drive::OnPortOut(void* pThis, unsigned char status)
 {
 	Drive* pDrive = (Drive*)pThis;
+	unsigned char headDirection = pDrive->lastHeadDirection;
+	bool LED = pDrive->LED;
 	if (pDrive->motor)
 		pDrive->MoveHead(status & 3);
 	pDrive->motor = (status & 4) != 0;
 	pDrive->CLOCK_SEL_AB = ((status >> 5) & 3);
 	pDrive->LED = (status & 8) != 0;
+	if (pDrive->LED != LED || pDrive->lastHeadDirection != headDirection)
+		pDrive->statusChanged.Signal();
 }
 
 bool Drive::Update()
 {
-#if defined(PROFILE)
-	perf_counters_t pct;
-	reset_performance_counters(&pct);
-
-#if defined(RPI2) || defined(RPI3) 
-	pct.num_counters = 6;
-	pct.type[0] = PERF_TYPE_L1I_CACHE;
-	pct.type[1] = PERF_TYPE_L1I_CACHE_REFILL;
-	pct.type[2] = PERF_TYPE_L1D_CACHE;
-	pct.type[3] = PERF_TYPE_L1D_CACHE_REFILL;
-	pct.type[4] = PERF_TYPE_L2D_CACHE_REFILL;
-	pct.type[5] = PERF_TYPE_INST_RETIRED;
-	pct.counter[0] = 100;
-	pct.counter[1] = 101;
-	pct.counter[2] = 102;
-	pct.counter[3] = 103;
-	pct.counter[4] = 104;
-	pct.counter[5] = 105;
-#else
-	pct.num_counters = 2;
-	//pct.type[0] = PERF_TYPE_EVERY_CYCLE;
-	pct.type[0] = PERF_TYPE_I_CACHE_MISS;
-	pct.type[1] = PERF_TYPE_D_CACHE_MISS;
-#endif
-
-#endif
-
 	bool dataReady = false;
 	
 	// When swapping some lame loaders monitor the write protect flag.
@@ -574,11 +600,6 @@ bool Drive::Update()
 	}
 	m_pVIA->InputCA1(!SO);
 
-#if defined(PROFILE)
-	read_performance_counters(&pct);
-	print_performance_counters(&pct);
-#endif
-
 	return dataReady;
 }
 
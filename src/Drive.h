@@ -21,6 +21,7 @@
 
 #include "m6522.h"
 #include "DiskImage.h"
+#include "CycleScheduler.h"
 #include <stdlib.h>
 
 #if defined(EXPERIMENTALZERO)
@@ -60,6 +61,11 @@ public:
 	inline const DiskImage* GetDiskImage() const { return diskImage; }
 	void Eject();
 	void Reset();
+
+	// The disk image is not part of the state; the head is positioned over whatever disk is inserted when loaded.
+	void SaveState(Snapshot& snapshot) const;
+	void LoadState(Snapshot& snapshot);
+
 	inline unsigned Track() const { return headTrackPos; }
 	inline unsigned SectorPos() const { return headBitOffset >> 3; }
 	inline unsigned GetHeadBitOffset() const { return headBitOffset; }
@@ -207,5 +213,8 @@ private:
 	float cyclesPerBit;
 	bool motor;
 	bool LED;
+
+public:
+	CycleSchedulerSignal statusChanged;	// The LED or the head direction changed
 };
 #endif
@@ -44,6 +44,7 @@ extern void GlobalSetDeviceID(u8 id);
 extern void CheckAutoMountImage(EXIT_TYPE reset_reason , FileBrowser* fileBrowser);
 
 extern bool SwitchDrive(const char* drive);
+extern bool IsUSBDriveMounted(int USBDriveIndex);
 extern int numberOfUSBMassStorageDevices;
 
 unsigned char FileBrowser::LSTBuffer[FileBrowser::LSTBuffer_size];
@@ -508,6 +509,58 @@ FileBrowser::BrowsableList::Entry* FileBrowser::BrowsableList::FindEntry(const c
 	return 0;
 }
 
+// FNV-1a of the name ignoring case (as FindEntry() does).
+static u32 HashEntryName(const char* name)
+{
+	u32 hash = 0x811c9dc5U;
+
+	while (*name)
+	{
+		hash ^= (u8)tolower(*name++);
+		hash *= 16777619U;
+	}
+	return hash;
+}
+
+void FileBrowser::BrowsableList::IndexEntries()
+{
+	u32 size = 16;
+	u32 index;
+
+	// At most half full so probes stay short.
+	while (size < entries.size() * 2)
+		size <<= 1;
+	nameIndex.assign(size, 0);
+
+	for (index = 0; index < entries.size(); ++index)
+	{
+		if (entries[index].filImage.fattrib & AM_DIR)
+			continue;
+
+		u32 slot = HashEntryName(entries[index].filImage.fname) & (size - 1);
+		while (nameIndex[slot])
+			slot = (slot + 1) & (size - 1);
+		nameIndex[slot] = index + 1;
+	}
+}
+
+FileBrowser::BrowsableList::Entry* FileBrowser::BrowsableList::FindIndexedEntry(const char* name)
+{
+	u32 size = nameIndex.size();
+
+	if (size == 0)
+		return FindEntry(name);
+
+	// Entries with the same name went in in order so the first one is found, as with FindEntry().
+	for (u32 slot = HashEntryName(name) & (size - 1); nameIndex[slot]; slot = (slot + 1) & (size - 1))
+	{
+		Entry* entry = &entries[nameIndex[slot] - 1];
+		if (strcasecmp(name, entry->filImage.fname) == 0)
+			return entry;
+	}
+	return 0;
+}
+
 FileBrowser::FileBrowser(InputMappings* inputMappings, DiskCaddy* diskCaddy, ROMs* roms, u8* deviceID, bool displayPNGIcons, ScreenBase* screenMain, ScreenBase* screenLCD, float scrollHighlightRate)
 	: inputMappings(inputMappings)
 	, state(State_Folders)
@@ -607,7 +660,10 @@ void FileBrowser::RefreshDevicesEntries(std::vector<FileBrowser::BrowsableList::
 		char USBDriveId[16];
 		sprintf(USBDriveId, "USB%02d:", USBDriveIndex + 1);
 
-		f_getlabel(USBDriveId, label, &vsn);
+		// Reading the label would mount the drive so it is only shown once the drive has been used.
+		label[0] = 0;
+		if (IsUSBDriveMounted(USBDriveIndex))
+			f_getlabel(USBDriveId, label, &vsn);
 
 		if (strlen(label) > 0)
 			sprintf(entry.filImage.fname, "%s %s", USBDriveId, label);
@@ -1341,36 +1397,69 @@ bool FileBrowser::SelectLST(const char* filenameLST)
 		res = f_open(&fp, filenameLST, FA_READ);
 		if (res == FR_OK)
 		{
-			u32 bytesRead;
-			SetACTLed(true);
-			f_read(&fp, FileBrowser::LSTBuffer, FileBrowser::LSTBuffer_size, &bytesRead);
-			SetACTLed(false);
-			f_close(&fp);
+			char* buffer = (char*)FileBrowser::LSTBuffer;
+			u32 length = 0;
+			u32 position = 0;
+			bool endOfFile = false;
 
-			TextParser textParser;
+			folder.IndexEntries();
 
-			textParser.SetData((char*)FileBrowser::LSTBuffer);
-			char* token = textParser.GetToken(true);
-			while (token)
+			// The LST is read a buffer full at a time and parsed a line at a time so it can be any length.
+			for (;;)
 			{
-				//DEBUG_LOG("LST token = %s\r\n", token);
-				diskType = DiskImage::GetDiskImageTypeViaExtention(token);
-				if (diskType == DiskImage::D64 || diskType == DiskImage::G64 || diskType == DiskImage::NIB || diskType == DiskImage::NBZ || diskType == DiskImage::T64)
+				u32 lineEnd = position;
+				while (lineEnd < length && buffer[lineEnd] != '\n' && buffer[lineEnd] != '\r')
+					lineEnd++;
+
+				// Only part of the line has been read so move it to the front and read the rest after it.
+				// (a line that will not fit in the buffer is split)
+				if (lineEnd == length && !endOfFile && (position != 0 || length < FileBrowser::LSTBuffer_size - 1))
 				{
-					FileBrowser::BrowsableList::Entry* entry = folder.FindEntry(token);
-					if (entry && !(entry->filImage.fattrib & AM_DIR))
-					{
-						bool readOnly = (entry->filImage.fattrib & AM_RDO) != 0;
-						if (diskCaddy->Insert(&entry->filImage, readOnly))
-							validImage = true;
-					}
+					u32 bytesRead;
+					memmove(buffer, buffer + position, length - position);
+					length -= position;
+					position = 0;
+					SetACTLed(true);
+					if (f_read(&fp, buffer + length, FileBrowser::LSTBuffer_size - 1 - length, &bytesRead) != FR_OK || bytesRead == 0)
+						endOfFile = true;
+					else
+						length += bytesRead;
+					SetACTLed(false);
+					continue;
 				}
-				else
+
+				if (position == length && endOfFile)
+					break;
+
+				char* line = buffer + position;
+				buffer[lineEnd] = '\0';
+				position = lineEnd < length ? lineEnd + 1 : length;
+
+				TextParser textParser;
+
+				textParser.SetData(line);
+				char* token = textParser.GetToken(true);
+				if (token)
 				{
-					roms->SelectROM(token);
+					//DEBUG_LOG("LST token = %s\r\n", token);
+					diskType = DiskImage::GetDiskImageTypeViaExtention(token);
+					if (diskType == DiskImage::D64 || diskType == DiskImage::G64 || diskType == DiskImage::NIB || diskType == DiskImage::NBZ || diskType == DiskImage::T64)
+					{
+						FileBrowser::BrowsableList::Entry* entry = folder.FindIndexedEntry(token);
+						if (entry && !(entry->filImage.fattrib & AM_DIR))
+						{
+							bool readOnly = (entry->filImage.fattrib & AM_RDO) != 0;
+							if (diskCaddy->Insert(&entry->filImage, readOnly))
+								validImage = true;
+						}
+					}
+					else
+					{
+						roms->SelectROM(token);
+					}
 				}
-				token = textParser.GetToken(true);
 			}
+			f_close(&fp);
 		}
 	}
 	return validImage;
@@ -1412,9 +1501,9 @@ void FileBrowser::DisplayStatusBar()
 
 	char bufferOut[128];
 	if (options.DisplayTemperature())
-		snprintf(bufferOut, 128, "LED 0 Motor 0 Track 18.0 ATN 0 DAT 0 CLK 0 00%cC", 248);
+		snprintf(bufferOut, 128, "LED 0 Motor 0 Track 18.0 ATN 0 DAT 0 CLK 0 00%cC Lost 0       ", 248);
 	else
-		snprintf(bufferOut, 128, "LED 0 Motor 0 Track 18.0 ATN 0 DAT 0 CLK 0");
+		snprintf(bufferOut, 128, "LED 0 Motor 0 Track 18.0 ATN 0 DAT 0 CLK 0      Lost 0       ");
 
 	screenMain->PrintText(false, x, y, bufferOut, RGBA(0, 0, 0, 0xff), RGBA(0xff, 0xff, 0xff, 0xff));
 #endif
@@ -103,6 +103,7 @@ public:
 		{
 			u32 index;
 			entries.clear();
+			nameIndex.clear();
 			current = 0;
 			currentIndex = 0;
 			for (index = 0; index < views.size(); ++index)
@@ -148,6 +149,10 @@ public:
 		};
 
 		Entry* FindEntry(const char* name);
+		// FindEntry() looks through every entry. For many lookups IndexEntries() hashes the names once (until the entries change)
+		// and FindIndexedEntry() then finds them in the hash table.
+		void IndexEntries();
+		Entry* FindIndexedEntry(const char* name);
 		int FindNextAutoName(char* basename);
 
 		void RefreshViews();
@@ -156,6 +161,7 @@ public:
 
 		InputMappings* inputMappings;
 		std::vector<Entry> entries;
+		std::vector<u32> nameIndex;	// Open addressed on the name's hash; each slot is 0 or an entries index + 1
 		Entry* current;
 		u32 currentIndex;
 		float currentHighlightTime;
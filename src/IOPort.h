@@ -19,6 +19,7 @@
 #ifndef IOPort_H
 #define IOPort_H
 #include <assert.h>
+#include "Snapshot.h"
 
 typedef void(*PortOutFn)(void*, unsigned char status);
 
@@ -39,6 +40,10 @@ public:
 	inline unsigned char GetDirection() { return direction; }
 	inline void SetDirection(unsigned char value) { direction = value; if (portOutFn) (portOutFn)(portOutFnThis, stateOut & direction); }
 	inline void SetPortOut(void* data, PortOutFn fn) { portOutFnThis = data; portOutFn = fn; }
+
+	// The port out function is not called on load; the owner does that once it has restored everything else.
+	void SaveState(Snapshot& snapshot) const { snapshot.Write(stateOut); snapshot.Write(stateIn); snapshot.Write(direction); }
+	void LoadState(Snapshot& snapshot) { snapshot.Read(stateOut); snapshot.Read(stateIn); snapshot.Read(direction); }
 private:
 	unsigned char stateOut;
 	unsigned char stateIn;
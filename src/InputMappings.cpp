@@ -31,6 +31,7 @@ extern void Reboot_Pi(void);
 // If disk swaps can be done via multiple cores then directDiskSwapRequest needs to be volatile. WARNING: volatile acesses can be very expensive.
 //volatile unsigned InputMappings::directDiskSwapRequest = 0;
 unsigned InputMappings::directDiskSwapRequest = 0;
+volatile u32 InputMappings::emulationRequests = 0;
 //volatile unsigned InputMappings::uartFlags = 0;
 //unsigned InputMappings::escapeSequenceIndex = 0;
 
@@ -162,6 +163,30 @@ void InputMappings::CheckButtonsEmulationMode()
 	}
 }
 
+void InputMappings::PollEmulationMode(unsigned numberOfImages, unsigned numberOfImagesMax, u32 elapsed)
+{
+	u32 requests;
+
+	IEC_Bus::ReadGPIOUserInput(read32(ARM_GPIO_GPLEV0), elapsed);
+#if not defined(EXPERIMENTALZERO)
+	CheckKeyboardEmulationMode(numberOfImages, numberOfImagesMax);
+#endif
+	CheckButtonsEmulationMode();
+
+	requests = directDiskSwapRequest << DIRECT_SWAP_SHIFT;
+	directDiskSwapRequest = 0;
+	if (Exit())
+		requests |= ESC_FLAG;
+	if (NextDisk())
+		requests |= NEXT_FLAG;
+	if (PrevDisk())
+		requests |= PREV_FLAG;
+	if (AutoLoad())
+		requests |= AUTOLOAD_FLAG;
+
+	if (requests)
+		__sync_fetch_and_or(&emulationRequests, requests);
+}
 
 //void InputMappings::CheckUart()
 //{
@@ -48,6 +48,9 @@
 #define FUNCTION_FLAG		(1 << 21)
 // dont exceed 32!!
 
+// The emulation requests use ESC_FLAG, NEXT_FLAG, PREV_FLAG and AUTOLOAD_FLAG with the direct disk swaps (caddy images 0-9) in the top bits.
+#define DIRECT_SWAP_SHIFT	22
+
 
 class InputMappings //: public Singleton<InputMappings>
 {
@@ -84,6 +87,24 @@ public:
 	bool CheckButtonsBrowseMode();
 	void CheckButtonsEmulationMode();
 
+	// While emulating the buttons and keyboard are polled away from the emulation loop (see StartInputPoller() in main.cpp).
+	// The poll publishes what was pressed into emulationRequests and the emulation loop takes them every EMULATION_INPUT_CYCLES.
+	void PollEmulationMode(unsigned numberOfImages, unsigned numberOfImagesMax, u32 elapsed);
+
+	inline void ResetEmulationRequests()
+	{
+		directDiskSwapRequest = 0;
+		emulationRequests = 0;
+	}
+
+	// Returns, and clears, everything requested since the last call.
+	inline u32 TakeEmulationRequests()
+	{
+		if (emulationRequests == 0)	// Only a plain read unless something has been pressed
+			return 0;
+		return __sync_fetch_and_and(&emulationRequests, 0);
+	}
+
 	void WaitForClearButtons();
 
 	static u8 INPUT_BUTTON_ENTER;
@@ -205,6 +226,8 @@ public:
 	// Used by the 2 cores so need to be volatile
 	//volatile static unsigned directDiskSwapRequest;
 	static unsigned directDiskSwapRequest;
+	// The single word shared with the emulation core. Only written when there is input so it stays in that core's cache.
+	static volatile u32 emulationRequests;
 	//volatile static unsigned uartFlags;	// WARNING uncached volatile accessed across cores can be very expensive and may cause the emulation to exceed the 1us time frame and a realtime cycle will not be emulated correctly!
 //private:
 //	static unsigned escapeSequenceIndex;
@@ -0,0 +1,264 @@
+// Pi1541 - A Commodore 1541 disk drive emulator
+// Copyright(C) 2018 Stephen White
+//
+// This file is part of Pi1541.
+//
+// Pi1541 is free software : you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Pi1541 is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Pi1541. If not, see <http://www.gnu.org/licenses/>.
+
+
+#include "JobSystem.h"
+extern "C"
+{
+#include "startup.h"
+}
+
+#if defined(BACKGROUND_JOBS)
+
+// A bounded multiple producer/multiple consumer queue (after Dmitry Vyukov's).
+// Each cell has a sequence number that says whether it is free to be written, or ready to be read, on the current lap of the ring.
+// Producers and consumers claim a cell by advancing their position with a compare and swap; nothing ever waits for another core.
+template <u32 SIZE>	// Must be a power of 2
+class JobQueue
+{
+public:
+	JobQueue()
+		: enqueuePos(0)
+		, dequeuePos(0)
+	{
+		for (u32 index = 0; index < SIZE; ++index)
+			cells[index].sequence = index;
+	}
+
+	// Returns false if the queue is full.
+	bool Push(Job* job)
+	{
+		Cell* cell;
+		u32 pos = enqueuePos;
+
+		for (;;)
+		{
+			cell = &cells[pos & (SIZE - 1)];
+			int diff = (int)(cell->sequence - pos);
+			if (diff == 0)
+			{
+				if (__sync_bool_compare_and_swap(&enqueuePos, pos, pos + 1))
+					break;
+			}
+			else if (diff < 0)
+			{
+				return false;
+			}
+			pos = enqueuePos;
+		}
+
+		cell->job = job;
+		// The job must be visible before the cell is marked as ready to be read.
+		_data_memory_barrier();
+		cell->sequence = pos + 1;
+		return true;
+	}
+
+	// Returns 0 if the queue is empty.
+	Job* Pop()
+	{
+		Cell* cell;
+		u32 pos = dequeuePos;
+
+		for (;;)
+		{
+			cell = &cells[pos & (SIZE - 1)];
+			int diff = (int)(cell->sequence - (pos + 1));
+			if (diff == 0)
+			{
+				// (the compare and swap is also a full barrier so the job is read after the sequence)
+				if (__sync_bool_compare_and_swap(&dequeuePos, pos, pos + 1))
+					break;
+			}
+			else if (diff < 0)
+			{
+				return 0;
+			}
+			pos = dequeuePos;
+		}
+
+		Job* job = cell->job;
+		// Finished with the cell before handing it back to the producers.
+		_data_memory_barrier();
+		cell->sequence = pos + SIZE;
+		return job;
+	}
+
+private:
+	struct Cell
+	{
+		volatile u32 sequence;
+		Job* job;
+	};
+
+	Cell cells[SIZE];
+	volatile u32 enqueuePos;
+	volatile u32 dequeuePos;
+};
+
+static inline void WakeCores()
+{
+	asm volatile ("dsb\n\tsev" ::: "memory");
+}
+
+static inline void WaitForEvent()
+{
+	asm volatile ("wfe" ::: "memory");
+}
+
+static JobQueue<32> queue;
+static JobQueue<8> mailboxes[JobSystem::NUM_WORKERS];
+static volatile u32 workerRunning[JobSystem::NUM_WORKERS];
+
+static bool Queue(Job* job, int core)
+{
+	if (core == JobSystem::ANY_WORKER)
+	{
+		if (JobSystem::GetNumberOfWorkers() == 0 || !queue.Push(job))
+			return false;
+	}
+	else
+	{
+		if (!JobSystem::IsWorkerRunning(core) || !mailboxes[core - JobSystem::FIRST_WORKER_CORE].Push(job))
+			return false;
+	}
+	WakeCores();
+	return true;
+}
+
+// The workers share the heap with the other cores so newlib's malloc needs a lock.
+// It has to be recursive (newlib can take it again while it is held) so it records the owning core.
+#define MALLOC_LOCK_FREE 0xffffffff
+
+static volatile u32 mallocLockOwner = MALLOC_LOCK_FREE;
+static u32 mallocLockDepth;
+
+extern "C"
+{
+	struct _reent;
+
+	void __malloc_lock(struct _reent*)
+	{
+		u32 core = _get_core();
+
+		// Only this core could have made itself the owner.
+		if (mallocLockOwner == core)
+		{
+			mallocLockDepth++;
+			return;
+		}
+
+		while (!__sync_bool_compare_and_swap(&mallocLockOwner, MALLOC_LOCK_FREE, core))
+			WaitForEvent();
+		mallocLockDepth = 1;
+	}
+
+	void __malloc_unlock(struct _reent*)
+	{
+		if (--mallocLockDepth == 0)
+		{
+			_data_memory_barrier();
+			mallocLockOwner = MALLOC_LOCK_FREE;
+			WakeCores();
+		}
+	}
+}
+
+#endif
+
+bool JobSystem::TrySubmit(Job* job, int core)
+{
+	job->done = 0;
+#if defined(BACKGROUND_JOBS)
+	if (Queue(job, core))
+		return true;
+#endif
+	job->done = 1;
+	return false;
+}
+
+void JobSystem::Submit(Job* job, int core)
+{
+	if (!TrySubmit(job, core))
+		Run(job);
+}
+
+void JobSystem::Wait(Job* job)
+{
+	while (!job->done)
+	{
+#if defined(BACKGROUND_JOBS)
+		WaitForEvent();
+#endif
+	}
+	// Don't look at the job's results until we have seen it is done.
+	_data_memory_barrier();
+}
+
+bool JobSystem::IsWorkerRunning(int core)
+{
+#if defined(BACKGROUND_JOBS)
+	if (core >= FIRST_WORKER_CORE && core < FIRST_WORKER_CORE + NUM_WORKERS)
+		return workerRunning[core - FIRST_WORKER_CORE] != 0;
+#endif
+	return false;
+}
+
+int JobSystem::GetNumberOfWorkers()
+{
+	int count = 0;
+	for (int core = FIRST_WORKER_CORE; core < FIRST_WORKER_CORE + NUM_WORKERS; ++core)
+	{
+		if (IsWorkerRunning(core))
+			count++;
+	}
+	return count;
+}
+
+void JobSystem::Run(Job* job)
+{
+	job->function(job->param);
+	// Everything the job wrote must be visible before it is seen to be done.
+	_data_memory_barrier();
+	job->done = 1;
+#if defined(BACKGROUND_JOBS)
+	WakeCores();
+#endif
+}
+
+void JobSystem::WorkerMain()
+{
+#if defined(BACKGROUND_JOBS)
+	int worker = _get_core() - FIRST_WORKER_CORE;
+
+	workerRunning[worker] = 1;
+	WakeCores();
+
+	for (;;)
+	{
+		Job* job = mailboxes[worker].Pop();
+		if (job == 0)
+			job = queue.Pop();
+
+		if (job)
+			Run(job);
+		else
+			WaitForEvent();	// Woken by the SEV after the next submit (or a spurious one which just means another look at the queues)
+	}
+#endif
+}
@@ -0,0 +1,97 @@
+// Pi1541 - A Commodore 1541 disk drive emulator
+// Copyright(C) 2018 Stephen White
+//
+// This file is part of Pi1541.
+//
+// Pi1541 is free software : you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Pi1541 is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Pi1541. If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifndef JOBSYSTEM_H
+#define JOBSYSTEM_H
+
+#include "defs.h"
+#include "types.h"
+
+// Runs work that does not have to be done on the calling core on the otherwise idle cores 2 and 3.
+//
+// Jobs are passed through lock-free queues so submitting one never blocks;-
+//	- the shared queue is taken from by whichever worker is free first
+//	- each worker also has its own mailbox for jobs that must all run on the same core (eg one after the other)
+// A worker sleeps (WFE) while there is nothing to do and is woken by the SEV after a job is submitted.
+//
+// Without BACKGROUND_JOBS (or before the workers have started) Submit() runs the job immediately on the calling core.
+// The emulation loops must never Wait() for a job and must only use TrySubmit() (which never runs the job itself).
+//
+// The Job itself (and anything it points to) belongs to the submitter and must stay valid until IsDone().
+// Jobs run concurrently with the submitting core so must not touch the SD card/USB (FatFs is not reentrant), the screen or the emulation.
+
+typedef void(*JobFunction)(void* param);
+
+struct Job
+{
+	Job()
+		: function(0)
+		, param(0)
+		, done(1)
+	{
+	}
+
+	Job(JobFunction function, void* param)
+		: function(function)
+		, param(param)
+		, done(1)
+	{
+	}
+
+	JobFunction function;
+	void* param;
+	volatile u32 done;
+};
+
+class JobSystem
+{
+public:
+	enum
+	{
+		FIRST_WORKER_CORE = 2,
+		NUM_WORKERS = 2,
+		ANY_WORKER = -1
+	};
+
+	// Queue the job to run on any worker (or the worker on that core).
+	// Returns false, without running the job, if there is no worker to take it or the queue is full.
+	static bool TrySubmit(Job* job, int core = ANY_WORKER);
+
+	// As TrySubmit() but if the job cannot be queued it is run now.
+	static void Submit(Job* job, int core = ANY_WORKER);
+
+	static inline bool IsDone(const Job* job) { return job->done != 0; }
+
+	// Blocks until the job has run.
+	static void Wait(Job* job);
+
+	// True once the worker on that core is taking jobs.
+	static bool IsWorkerRunning(int core);
+
+	// Number of workers taking jobs (0 if jobs are run inline).
+	static int GetNumberOfWorkers();
+
+	// The worker loop. Entered by cores 2 and 3 once they are running with the MMU and caches enabled; never returns.
+	static void WorkerMain();
+
+private:
+	static void Run(Job* job);
+};
+
+#endif
@@ -0,0 +1,83 @@
+// Pi1541 - A Commodore 1541 disk drive emulator
+// Copyright(C) 2018 Stephen White
+//
+// This file is part of Pi1541.
+//
+// Pi1541 is free software : you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Pi1541 is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Pi1541. If not, see <http://www.gnu.org/licenses/>.
+
+#include "PCHistogram.h"
+#include <stdio.h>
+#include <string.h>
+#include "ff.h"
+
+void PCHistogram::Reset()
+{
+	memset(counts, 0, sizeof(counts));
+}
+
+void PCHistogram::Dump(const char* name, u32 romBase) const
+{
+	u32 hotPC[HOT_SPOTS];
+	u32 hotCount[HOT_SPOTS];
+	int hotSpots = 0;
+	unsigned long long total = 0;
+	unsigned long long rom = 0;
+	u32 pc;
+
+	for (pc = 0; pc < 65536; ++pc)
+	{
+		u32 count = counts[pc];
+		if (count == 0)
+			continue;
+
+		total += count;
+		if (pc >= romBase)
+			rom += count;
+
+		// Insert into the (sorted) hot spot list
+		if (hotSpots < HOT_SPOTS || count > hotCount[hotSpots - 1])
+		{
+			int index = hotSpots < HOT_SPOTS ? hotSpots++ : HOT_SPOTS - 1;
+			while (index > 0 && hotCount[index - 1] < count)
+			{
+				hotPC[index] = hotPC[index - 1];
+				hotCount[index] = hotCount[index - 1];
+				index--;
+			}
+			hotPC[index] = pc;
+			hotCount[index] = count;
+		}
+	}
+
+	if (total == 0)
+		return;
+
+	printf("%s PC histogram: %llu instructions, RAM %u%% ROM %u%%\r\n", name, total, (unsigned)((total - rom) * 100 / total), (unsigned)(rom * 100 / total));
+	for (int index = 0; index < hotSpots; ++index)
+		printf("  %04x %10u %3u%%\r\n", (unsigned)hotPC[index], (unsigned)hotCount[index], (unsigned)(hotCount[index] * 100ULL / total));
+}
+
+bool PCHistogram::Save(const char* fileName) const
+{
+	FIL fp;
+	UINT bytesWritten = 0;
+	bool ok = false;
+
+	if (f_open(&fp, fileName, FA_CREATE_ALWAYS | FA_WRITE) == FR_OK)
+	{
+		ok = f_write(&fp, counts, sizeof(counts), &bytesWritten) == FR_OK && bytesWritten == sizeof(counts);
+		f_close(&fp);
+	}
+	return ok;
+}
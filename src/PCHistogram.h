@@ -0,0 +1,55 @@
+// Pi1541 - A Commodore 1541 disk drive emulator
+// Copyright(C) 2018 Stephen White
+//
+// This file is part of Pi1541.
+//
+// Pi1541 is free software : you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Pi1541 is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Pi1541. If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef PCHISTOGRAM_H
+#define PCHISTOGRAM_H
+
+#include "types.h"
+
+// Counts how many times each emulated 6502 instruction is started (enable PC_HISTOGRAM in defs.h).
+// Sampled by the emulation loop when SYNC() indicates an instruction boundary.
+// Used to find where the drive ROM or the fast loader / custom drive code uploaded to RAM spends its time.
+class PCHistogram
+{
+public:
+	enum
+	{
+		HOT_SPOTS = 16	// How many of the busiest instructions Dump() lists
+	};
+
+	void Reset();
+
+	inline void Sample(u16 pc)
+	{
+		counts[pc]++;
+	}
+
+	inline u32 GetCount(u16 pc) const { return counts[pc]; }
+
+	// Print the RAM/ROM split and the hot spots to the UART.
+	// Anything from romBase up is counted as ROM.
+	void Dump(const char* name, u32 romBase) const;
+
+	// Write the raw histogram (65536 little endian u32 counts indexed by PC) to a file.
+	bool Save(const char* fileName) const;
+
+private:
+	u32 counts[65536];
+};
+
+#endif
@@ -20,6 +20,7 @@
 #include "debug.h"
 #include "options.h"
 #include "ROMs.h"
+#include "Profile.h"
 
 extern Options options;
 extern Pi1541 pi1541;
@@ -182,15 +183,43 @@ void Pi1541::Initialise()
 
 void Pi1541::Update()
 {
-	if (drive.Update())
+	PROFILE_BEGIN(PROFILE_DRIVE);
+	bool dataReady = drive.Update();
+	PROFILE_END(PROFILE_DRIVE);
+	if (dataReady)
 	{
 		//This pin sets the overflow flag on a negative transition from TTL one to TTL zero.
 		// SO is sampled at the trailing edge of P1, the cpu V flag is updated at next P1.
 		m6502.SO();
 	}
 
+	PROFILE_BEGIN(PROFILE_VIAS);
 	VIA[1].Execute();
 	VIA[0].Execute();
+	PROFILE_END(PROFILE_VIAS);
+}
+
+bool Pi1541::SaveState(Snapshot& snapshot, u32 ramSize)
+{
+	if (!m6502.SYNC())
+		return false;
+
+	VIA[0].SaveState(snapshot);
+	VIA[1].SaveState(snapshot);
+	drive.SaveState(snapshot);
+	snapshot.Write(s_u8Memory, ramSize);
+	return m6502.SaveState(snapshot);
+}
+
+void Pi1541::LoadState(Snapshot& snapshot, u32 ramSize)
+{
+	// The VIAs will update the drive and IEC bus with their restored outputs.
+	VIA[0].LoadState(snapshot);
+	VIA[1].LoadState(snapshot);
+	drive.LoadState(snapshot);
+	snapshot.Read(s_u8Memory, ramSize);
+	// Last as the VIAs will have set the IRQ line as they were loaded.
+	m6502.LoadState(snapshot);
 }
 
 void Pi1541::Reset()
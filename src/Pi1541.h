@@ -35,6 +35,11 @@ public:
 
 	void Reset();
 
+	// The state of the whole drive including the first ramSize bytes of RAM.
+	// Can only be saved on an instruction boundary (returns false if not).
+	bool SaveState(Snapshot& snapshot, u32 ramSize);
+	void LoadState(Snapshot& snapshot, u32 ramSize);
+
 	//void ConfigureOfExtraRAM(bool extraRAM);
 
 	Drive drive;
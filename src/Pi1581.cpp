@@ -22,6 +22,7 @@
 #include "options.h"
 #include "ROMs.h"
 #include "debug.h"
+#include "Profile.h"
 
 extern Pi1581 pi1581;
 extern u8 s_u8Memory[0xc000];
@@ -238,7 +239,9 @@ void Pi1581::Update()
 		}
 	}
 
+	PROFILE_BEGIN(PROFILE_VIAS);
 	CIA.Execute();
+	PROFILE_END(PROFILE_VIAS);
 
 	// SRQ is pulled high by the c128
 
@@ -268,10 +271,9 @@ void Pi1581::Update()
 		CIA.SetPinCNT(IEC_Bus::GetPI_SRQ());
 	}
 
-	for (int i = 0; i < 4; ++i)
-	{
-		wd177x.Execute();
-	}
+	PROFILE_BEGIN(PROFILE_DRIVE);
+	wd177x.Execute(4);
+	PROFILE_END(PROFILE_DRIVE);
 }
 
 void Pi1581::Reset()
@@ -45,7 +45,14 @@ public:
 
 	inline bool IsLEDOn() const { return LED; }
 	inline bool IsMotorOn() const { return wd177x.IsExternalMotorAsserted(); }
-	inline void SetLED(bool value) { LED = value; }
+	inline void SetLED(bool value)
+	{
+		if (LED != value)
+		{
+			LED = value;
+			statusChanged.Signal();
+		}
+	}
 	//Drive drive;
 	WD177x wd177x;
 	m8520 CIA;
@@ -55,6 +62,8 @@ public:
 	unsigned fastSerialDirection;
 	unsigned int RDYDelayCount;
 
+	CycleSchedulerSignal statusChanged;	// The LED changed (see wd177x.headMoved for the head)
+
 private:
 	DiskImage* diskImage;
 	bool LED;
@@ -0,0 +1,61 @@
+// Pi1541 - A Commodore 1541 disk drive emulator
+// Copyright(C) 2018 Stephen White
+//
+// This file is part of Pi1541.
+//
+// Pi1541 is free software : you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Pi1541 is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Pi1541. If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include "defs.h"
+
+// Breakdown of where the emulation core's time goes (enable PROFILE in defs.h).
+// Each subsystem is bracketed with PROFILE_BEGIN/PROFILE_END and the ARM performance counters are accumulated per subsystem.
+// The counters take time to read so expect lost cycles while profiling; the proportions are what is of interest.
+#if defined(PROFILE)
+
+extern "C"
+{
+#include "performance.h"
+}
+
+enum ProfileSection
+{
+	PROFILE_CPU,	// 6502 step
+	PROFILE_DRIVE,	// Disk head (1541) or WD177x (1581)
+	PROFILE_VIAS,	// VIAs (1541) or CIA (1581)
+	PROFILE_BUS,	// IEC bus reads and refreshing the outputs
+	PROFILE_INPUT,	// Buttons and keyboard
+
+	PROFILE_SECTIONS
+};
+
+extern perf_section_t profileSections[PROFILE_SECTIONS];
+
+// Start profiling a new emulation session (call from the emulation core).
+void ProfileReset();
+void ProfileDump(const char* name);
+
+#define PROFILE_BEGIN(section) perf_section_begin(&profileSections[section])
+#define PROFILE_END(section) perf_section_end(&profileSections[section])
+
+#else
+
+#define PROFILE_BEGIN(section)
+#define PROFILE_END(section)
+
+#endif
+
+#endif
@@ -21,6 +21,9 @@
 #include <string.h>
 #include "Petscii.h"
 
+// The most bytes RefreshStep() puts into the I2C FIFO each call
+#define SSD1306_REFRESH_STEP_BYTES 4
+
 extern "C"
 {
 #include "xga_font_data.h"
@@ -36,6 +39,10 @@ SSD1306::SSD1306(int BSCMaster, u8 address, unsigned width, unsigned height, int
 	, contrast(127)
 	, width(width)
 	, height(height)
+	, refreshSource(0)
+	, refreshWriting(false)
+	, refreshPage(0)
+	, refreshDataLength(0)
 {
 	sizeof_frame = width*height/8;
 	frame = (unsigned char *)malloc(sizeof_frame);
@@ -173,11 +180,8 @@ void SSD1306::RefreshTextRows(u32 start, u32 amountOfRows)
 // it scans the page to work out the first (new_start) and last (new_end) changed bytes
 // Only update that window on the OLED
 // If someone is keen, a smarter algorithm could work out a series of ranges to update
-void SSD1306::RefreshPage(u32 page)
+bool SSD1306::FindPageChanges(const unsigned char* source, u32& page, int& new_start, int& new_end)
 {
-	if (page >= height/8)
-		return;
-
 	// x32 displays use lower half (pages 2 and 3)
 	if (type == LCD_1306_128x32)
 	{
@@ -189,20 +193,32 @@ void SSD1306::RefreshPage(u32 page)
 	int start = page*width;
 	int end = start + width;
 
-	int new_start = -1;
-	int new_end = -1;
+	new_start = -1;
+	new_end = -1;
 	for (i = start; i < end; i++)
 	{
-		if (oldFrame[i] ^ frame[i])
+		if (oldFrame[i] ^ source[i])
 		{
 			if (new_start == -1)
 				new_start = i;
 			new_end = i;
 		}
 	}
+	return new_start >= 0;
+}
 
-	if (new_start >= 0)
+void SSD1306::RefreshPage(u32 page)
+{
+	if (page >= height/8)
+		return;
+
+	int i;
+	int new_start;
+	int new_end;
+
+	if (FindPageChanges(frame, page, new_start, new_end))
 	{
+		int start = page*width;
 		SetDataPointer(page, new_start-start);
 		new_end++;
 		while (new_start < new_end)
@@ -224,6 +240,66 @@ void SSD1306::RefreshPage(u32 page)
 	}
 }
 
+void SSD1306::BeginRefresh(const void* source)
+{
+	refreshSource = source ? (const unsigned char*)source : frame;
+	refreshPage = 0;
+}
+
+// Each changed page goes as two writes; the data pointer commands then the changed bytes in one run.
+bool SSD1306::RefreshStep()
+{
+	if (refreshWriting)
+	{
+		if (!RPI_I2CWriteStep(&refreshWrite, SSD1306_REFRESH_STEP_BYTES))
+			return false;
+		refreshWriting = false;
+	}
+
+	if (refreshDataLength)
+	{
+		RPI_I2CWriteBegin(&refreshWrite, BSCMaster, address, refreshData, refreshDataLength, SSD1306_REFRESH_STEP_BYTES);
+		refreshDataLength = 0;
+		refreshWriting = true;
+		return false;
+	}
+
+	while (refreshPage < height/8)
+	{
+		u32 page = refreshPage++;
+		int new_start;
+		int new_end;
+
+		if (FindPageChanges(refreshSource, page, new_start, new_end))
+		{
+			int col = new_start - page*width;
+			int length = new_end - new_start + 1;
+
+			if (type == LCD_1106_128x64)
+				col += 2;	// sh1106 uses columns 2..129
+
+			refreshCommands[0] = SSD1306_CONTROL_REG;
+			refreshCommands[1] = SSD1306_CMD_SET_PAGE | page;
+			refreshCommands[2] = SSD1306_CMD_SET_COLUMN_LOW | (col & 0xf);
+			refreshCommands[3] = SSD1306_CMD_SET_COLUMN_HIGH | (col >> 4);
+			RPI_I2CWriteBegin(&refreshWrite, BSCMaster, address, refreshCommands, sizeof(refreshCommands), SSD1306_REFRESH_STEP_BYTES);
+			refreshWriting = true;
+
+			refreshData[0] = SSD1306_DATA_REG;
+			memcpy(&refreshData[1], &refreshSource[new_start], length);
+			memcpy(&oldFrame[new_start], &refreshSource[new_start], length);
+			refreshDataLength = length + 1;
+			return false;
+		}
+	}
+	return true;
+}
+
+void SSD1306::SaveFrame(void* destination) const
+{
+	memcpy(destination, frame, sizeof_frame);
+}
+
 void SSD1306::ClearScreen()
 {
 	memset(frame, 0, sizeof_frame);
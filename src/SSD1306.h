@@ -95,6 +95,14 @@ public:
 	void PlotPixel(int x, int y, int c);
 	void PlotImage(const unsigned char * source);
 
+	// A refresh that never waits on the I2C bus. Call RefreshStep() regularly until it returns true.
+	// The display is refreshed from source (eg a frame saved earlier) rather than the frame if one is given.
+	void BeginRefresh(const void* source = 0);
+	bool RefreshStep();
+
+	unsigned GetFrameSize() const { return sizeof_frame; }
+	void SaveFrame(void* destination) const;
+
 protected:
 	void SendCommand(u8 command);
 	void SendData(u8 data);
@@ -102,6 +110,7 @@ protected:
 
 	void Home();
 	void SetDataPointer(u8 row, u8 col);
+	bool FindPageChanges(const unsigned char* source, u32& page, int& firstChanged, int& lastChanged);
 
 //	unsigned char frame[SSD1306_128x64_BYTES];
 //	unsigned char oldFrame[SSD1306_128x64_BYTES];
@@ -116,6 +125,14 @@ protected:
 	int contrast;
 	unsigned width;
 	unsigned height;
+
+	TI2CWrite refreshWrite;
+	const unsigned char* refreshSource;
+	bool refreshWriting;
+	u32 refreshPage;
+	unsigned refreshDataLength;	// Queued behind the data pointer commands
+	unsigned char refreshCommands[4];
+	unsigned char refreshData[1 + 128];
 };
 #endif
 
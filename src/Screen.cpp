@@ -29,6 +29,7 @@ extern "C"
 	#include "rpi-mailbox-interface.h"
 	#include "xga_font_data.h"
 }
+#include "rpiHardware.h"
 
 extern u32 RPi_CpuId;
 
@@ -36,6 +37,10 @@ extern unsigned char* CBMFont;
 
 static const int BitFontHt = 16;
 static const int BitFontWth = 8;
+// The most glyphs (whole and cut off) that fit across the widest screen Open allows
+static const int MaxTextGlyphs = 1024 / BitFontWth + 1;
+// A flip only lands at the next vertical blank so the page that was shown is left alone for at least a frame.
+static const u32 CompositePeriod = 20000;
 
 void Screen::Open(u32 widthDesired, u32 heightDesired, u32 colourDepth)
 {
@@ -73,15 +78,19 @@ void Screen::Open(u32 widthDesired, u32 heightDesired, u32 colourDepth)
 
 	//DEBUG_LOG("width = %d height = %d depth = %d\r\n", width, height, depth);
 
+	// A second page to composite into while the first is shown (if the GPU can't give us that, just the one).
+	u32 virtualHeight = heightDesired * 2;
+	pageCount = 1;
 	do
 	{
 		RPI_PropertyInit();
 		RPI_PropertyAddTag(TAG_ALLOCATE_BUFFER);
 		RPI_PropertyAddTag(TAG_SET_PHYSICAL_SIZE, widthDesired, heightDesired);
-		RPI_PropertyAddTag(TAG_SET_VIRTUAL_SIZE, widthDesired, heightDesired);	// Don't need to double buffer (yet).
+		RPI_PropertyAddTag(TAG_SET_VIRTUAL_SIZE, widthDesired, virtualHeight);
 		RPI_PropertyAddTag(TAG_SET_DEPTH, colourDepth);
 		RPI_PropertyAddTag(TAG_GET_PITCH);
 		RPI_PropertyAddTag(TAG_GET_PHYSICAL_SIZE);
+		RPI_PropertyAddTag(TAG_GET_VIRTUAL_SIZE);
 		RPI_PropertyAddTag(TAG_GET_DEPTH);
 		RPI_PropertyProcess();
 
@@ -97,10 +106,23 @@ void Screen::Open(u32 widthDesired, u32 heightDesired, u32 colourDepth)
 		if ((mp = RPI_PropertyGet(TAG_GET_PITCH)))
 			pitch = mp->data.buffer_32[0];
 
+		if ((mp = RPI_PropertyGet(TAG_GET_VIRTUAL_SIZE)))
+			pageCount = (u32)mp->data.buffer_32[1] >= height * 2 ? 2 : 1;
+
 		if ((mp = RPI_PropertyGet(TAG_ALLOCATE_BUFFER)))
-			framebuffer = (unsigned char*)(mp->data.buffer_32[0] & 0x3FFFFFFF);
+			pages = (unsigned char*)(mp->data.buffer_32[0] & 0x3FFFFFFF);
+
+		virtualHeight = heightDesired;
 	}
-	while (framebuffer == 0);
+	while (pages == 0);
+
+	// Everything is drawn to the shadow. The page shown starts as a copy of it and the other one has yet to be given any of it.
+	framebuffer = (unsigned char*)calloc(pitch * height, 1);
+	tilesAcross = (width + TILE_WIDTH - 1) / TILE_WIDTH;
+	tilesDown = (height + TILE_HEIGHT - 1) / TILE_HEIGHT;
+	tileStale = (u8*)malloc(tilesAcross * tilesDown);
+	memset((void*)tileStale, ((1 << pageCount) - 1) & ~1, tilesAcross * tilesDown);
+	visiblePage = 0;
 
 
 	//RPI_PropertyInit();
@@ -124,9 +146,119 @@ void Screen::Open(u32 widthDesired, u32 heightDesired, u32 colourDepth)
 		break;
 	}
 
+#if not defined(EXPERIMENTALZERO)
+	for (u32 tile = 0; tile < tilesAcross * tilesDown; ++tile)
+		PresentTile(tile, 0);
+#endif
+
 	opened = true;
 }
 
+// Marks the tiles a drawing operation touched.
+void Screen::Damage(u32 x1, u32 y1, u32 x2, u32 y2)
+{
+#if not defined(EXPERIMENTALZERO)
+	if (!opened)
+		return;
+
+	ClipRect(x1, y1, x2, y2);
+	if (x2 <= x1 || y2 <= y1)
+		return;
+
+	u8 allPages = (1 << pageCount) - 1;
+	for (u32 tileY = y1 / TILE_HEIGHT; tileY <= (y2 - 1) / TILE_HEIGHT; ++tileY)
+	{
+		for (u32 tileX = x1 / TILE_WIDTH; tileX <= (x2 - 1) / TILE_WIDTH; ++tileX)
+		{
+			u32 tile = tileY * tilesAcross + tileX;
+			if (compositing)
+			{
+				// Another core may be compositing this tile (the atomic or is also a barrier so the pixels are seen before the mark).
+				__sync_fetch_and_or(&tileStale[tile], allPages);
+			}
+			else
+			{
+				tileStale[tile] = allPages & ~(1 << visiblePage);
+				PresentTile(tile, visiblePage);
+			}
+		}
+	}
+	if (compositing)
+		damaged = 1;
+#endif
+}
+
+// Copies a tile of the shadow to a page.
+void Screen::PresentTile(u32 tile, u32 page)
+{
+	u32 x = (tile % tilesAcross) * TILE_WIDTH;
+	u32 y = (tile / tilesAcross) * TILE_HEIGHT;
+	u32 rows = height - y < TILE_HEIGHT ? height - y : TILE_HEIGHT;
+	u32 bytes = ((width - x < TILE_WIDTH) ? width - x : TILE_WIDTH) * (bpp >> 3);
+	const unsigned char* source = framebuffer + y * pitch + x * (bpp >> 3);
+	unsigned char* dest = pages + (page * height + y) * pitch + x * (bpp >> 3);
+
+	// (If the shadow is drawn to as it is copied the tile is marked stale again and copied next time.)
+	for (u32 row = 0; row < rows; ++row, source += pitch, dest += pitch)
+		memcpy(dest, source, bytes);
+}
+
+bool Screen::Composite()
+{
+#if not defined(EXPERIMENTALZERO)
+	if (!compositing || !damaged)
+		return false;
+
+	u32 now = read32(ARM_SYSTIMER_CLO);
+	if (now - flipTime < CompositePeriod)
+		return false;
+
+	// Anything damaged from here on will be picked up next time.
+	damaged = 0;
+	__sync_synchronize();
+
+	u32 page = visiblePage ^ 1;
+	u8 pageMask = 1 << page;
+	bool copied = false;
+	bool visibleStale = false;
+	for (u32 tile = 0; tile < tilesAcross * tilesDown; ++tile)
+	{
+		if (tileStale[tile] & pageMask)
+		{
+			__sync_fetch_and_and(&tileStale[tile], (u8)~pageMask);
+			PresentTile(tile, page);
+			copied = true;
+		}
+		if (tileStale[tile] & (pageMask ^ 3))
+			visibleStale = true;
+	}
+	// Nothing to flip for if what is shown is still what was drawn.
+	if (!copied && !visibleStale)
+		return false;
+
+	RPI_PropertyInit();
+	RPI_PropertyAddTag(TAG_SET_VIRTUAL_OFFSET, 0, page * height);
+	RPI_PropertyProcess();
+	visiblePage = page;
+	flipTime = now;
+
+	// The page now hidden still needs everything that was copied to this one.
+	damaged = 1;
+	return true;
+#else
+	return false;
+#endif
+}
+
+void Screen::SwapBuffers()
+{
+#if not defined(EXPERIMENTALZERO)
+	// Wake the compositor's core (it sleeps on WFE between updates).
+	if (compositing)
+		__asm ("SEV");
+#endif
+}
+
 void Screen::PlotPixel32(u32 pixel_offset, RGBA Colour)
 {
 #if not defined(EXPERIMENTALZERO)
@@ -154,19 +286,91 @@ void Screen::PlotPixel8(u32 pixel_offset, RGBA Colour)
 #endif
 }
 
+// Stores a colour in the framebuffer's format (as the PlotPixel functions do).
+static inline void EncodePixel(unsigned char* dest, RGBA colour, u32 bpp)
+{
+	switch (bpp)
+	{
+		case 32:
+			*(RGBA*)dest = colour;
+		break;
+		case 24:
+			dest[0] = BLUE(colour);
+			dest[1] = GREEN(colour);
+			dest[2] = RED(colour);
+		break;
+		default:
+		case 16:
+			*(unsigned short*)dest = ((RED(colour) >> 3) << 11) | ((GREEN(colour) >> 2) << 5) | (BLUE(colour) >> 3);
+		break;
+		case 8:
+			dest[0] = RED(colour);
+		break;
+	}
+}
+
+// Fills a row of pixels from a pattern of 4 of them (BYTES_PER_PIXEL words).
+// The few pixels before the first word boundary and after the last whole pattern are copied a byte at a time.
+template <u32 BYTES_PER_PIXEL>
+static void FillRow(unsigned char* dest, u32 count, const u32* pattern)
+{
+	const unsigned char* patternBytes = (const unsigned char*)pattern;
+
+	for (u32 head = 0; head < 3 && count && ((size_t)dest & 3); ++head, --count)
+	{
+		for (u32 index = 0; index < BYTES_PER_PIXEL; ++index)
+			*dest++ = patternBytes[index];
+	}
+
+	for (; count >= 4; count -= 4, dest += 4 * BYTES_PER_PIXEL)
+	{
+		for (u32 word = 0; word < BYTES_PER_PIXEL; ++word)
+			((u32*)dest)[word] = pattern[word];
+	}
+
+	for (u32 index = 0; index < count * BYTES_PER_PIXEL; ++index)
+		*dest++ = patternBytes[index];
+}
+
 void Screen::DrawRectangle(u32 x1, u32 y1, u32 x2, u32 y2, RGBA colour)
 {
 	ClipRect(x1, y1, x2, y2);
 
-	for (u32 y = y1; y < y2; y++)
+#if not defined(EXPERIMENTALZERO)
+	if (x2 <= x1 || y2 <= y1)
+		return;
+
+	u32 bytesPerPixel = bpp >> 3;
+	u32 pattern[4];
+	for (u32 pixel = 0; pixel < 4; ++pixel)
+		EncodePixel((unsigned char*)pattern + pixel * bytesPerPixel, colour, bpp);
+
+	unsigned char* dest = framebuffer + y1 * pitch + x1 * bytesPerPixel;
+	u32 count = x2 - x1;
+	for (u32 y = y1; y < y2; y++, dest += pitch)
 	{
-		u32 line = y * pitch;
-		for (u32 x = x1; x < x2; x++)
+		switch (bpp)
 		{
-			u32 pixel_offset = (x * (bpp >> 3)) + line;
-			(this->*Screen::plotPixelFn)(pixel_offset, colour);
+			case 32:
+				FillRow<4>(dest, count, pattern);
+			break;
+			case 24:
+				FillRow<3>(dest, count, pattern);
+			break;
+			case 16:
+				FillRow<2>(dest, count, pattern);
+			break;
+			case 8:
+				FillRow<1>(dest, count, pattern);
+			break;
+			default:
+				for (u32 x = x1; x < x2; x++)
+					(this->*Screen::plotPixelFn)((x * bytesPerPixel) + y * pitch, colour);
+			break;
 		}
 	}
+	Damage(x1, y1, x2, y2);
+#endif
 }
 
 void Screen::ScrollArea(u32 x1, u32 y1, u32 x2, u32 y2)
@@ -186,6 +390,7 @@ void Screen::ScrollArea(u32 x1, u32 y1, u32 x2, u32 y2)
 			*(unsigned short*)&framebuffer[pixel_offsetDest] = *(unsigned short*)&framebuffer[pixel_offset];
 		}
 	}
+	Damage(x1, y1, x2, y2);
 }
 
 void Screen::Clear(RGBA colour)
@@ -239,8 +444,8 @@ void Screen::WriteChar(bool petscii, u32 x, u32 y, unsigned char c, RGBA colour)
 		}
 		for (u32 py = 0; py < fontHeight; ++py)
 		{
-			if (y + py > height)
-				return;
+			if (y + py >= height)
+				break;
 
 			unsigned char b = fontBitMap[c * fontHeight + py];
 			int yoffs = (y + py) * pitch;
@@ -255,7 +460,142 @@ void Screen::WriteChar(bool petscii, u32 x, u32 y, unsigned char c, RGBA colour)
 				b = b << 1;
 			}
 		}
+		Damage(x, y, x + 8, y + fontHeight);
+	}
+}
+
+// Looks up (or builds) the spans for a colour pair.
+// Text is drawn with a handful of colour pairs so a small round robin cache rarely has to rebuild one.
+const Screen::TextSpans* Screen::GetTextSpans(RGBA textColour, RGBA backgroundColour)
+{
+	for (u32 index = 0; index < TEXT_SPANS_CACHED; ++index)
+	{
+		TextSpans* spans = &textSpans[index];
+		if (spans->bpp == bpp && spans->textColour == textColour && spans->backgroundColour == backgroundColour)
+			return spans;
+	}
+
+	TextSpans* spans = &textSpans[nextTextSpans];
+	nextTextSpans = (nextTextSpans + 1) % TEXT_SPANS_CACHED;
+
+	u32 bytesPerPixel = bpp >> 3;
+	for (u32 pattern = 0; pattern < 256; ++pattern)
+	{
+		unsigned char* pixel = (unsigned char*)spans->pixels[pattern];
+		for (u32 px = 0; px < 8; ++px, pixel += bytesPerPixel)
+			EncodePixel(pixel, (pattern & (0x80 >> px)) ? textColour : backgroundColour, bpp);
+	}
+	spans->textColour = textColour;
+	spans->backgroundColour = backgroundColour;
+	spans->bpp = bpp;
+	return spans;
+}
+
+// Copies the spans for a run of glyphs to the framebuffer a pixel row at a time.
+// A glyph's span is 8 * BYTES_PER_PIXEL bytes (always whole words) so if the run starts on a word it is copied with word stores.
+template <u32 BYTES_PER_PIXEL>
+static void BlitTextRows(unsigned char* dest, u32 pitch, u32 rows, const unsigned char* const* glyphs, u32 count, u32 lastPixels, const u32 (*pixels)[8])
+{
+	const u32 words = 2 * BYTES_PER_PIXEL;
+	bool aligned = (((size_t)dest | pitch) & 3) == 0;
+
+	for (u32 row = 0; row < rows; ++row, dest += pitch)
+	{
+		unsigned char* out = dest;
+		for (u32 index = 0; index < count; ++index, out += words * 4)
+		{
+			const u32* span = pixels[glyphs[index][row]];
+			if (aligned)
+			{
+				for (u32 word = 0; word < words; ++word)
+					((u32*)out)[word] = span[word];
+			}
+			else
+			{
+				memcpy(out, span, words * 4);
+			}
+		}
+		// The glyph cut off by the right edge of the screen
+		if (lastPixels)
+			memcpy(out, pixels[glyphs[count][row]], lastPixels * BYTES_PER_PIXEL);
+	}
+}
+
+// Draws a line of text and the background behind it.
+void Screen::DrawText(bool petscii, u32 x, u32 y, const char* text, u32 count, RGBA textColour, RGBA backgroundColour)
+{
+#if not defined(EXPERIMENTALZERO)
+	if (!opened || x >= width || y >= height)
+		return;
+
+	u32 fontHeight;
+	const unsigned char* fontBitMap;
+	bool cbm = petscii && CBMFont;
+	if (cbm)
+	{
+		fontBitMap = CBMFont;
+		fontHeight = 8;
+	}
+	else
+	{
+		fontBitMap = avpriv_vga16_font;
+		fontHeight = BitFontHt;
+	}
+
+	if (bpp != 32 && bpp != 24 && bpp != 16 && bpp != 8)
+	{
+		for (u32 index = 0; index < count; ++index)
+		{
+			u32 xCursor = x + index * BitFontWth;
+			DrawRectangle(xCursor, y, xCursor + BitFontWth, y + fontHeight, backgroundColour);
+			WriteChar(petscii, xCursor, y, text[index], textColour);
+		}
+		return;
+	}
+
+	u32 rows = height - y;
+	if (rows > fontHeight)
+		rows = fontHeight;
+
+	// Only the glyphs that are at least partly on the screen are drawn.
+	u32 pixelsVisible = width - x;
+	if (pixelsVisible > count * BitFontWth)
+		pixelsVisible = count * BitFontWth;
+	if (pixelsVisible > (MaxTextGlyphs - 1) * BitFontWth)
+		pixelsVisible = (MaxTextGlyphs - 1) * BitFontWth;
+	u32 glyphCount = pixelsVisible / BitFontWth;
+	u32 lastPixels = pixelsVisible % BitFontWth;
+
+	const unsigned char* glyphs[MaxTextGlyphs];
+	for (u32 index = 0; index < glyphCount + (lastPixels ? 1 : 0); ++index)
+	{
+		unsigned char c = text[index];
+		if (cbm)
+			c = petscii2screen(c);
+		else if (petscii)
+			c = vga2screen(c);
+		glyphs[index] = fontBitMap + c * fontHeight;
+	}
+
+	const u32 (*pixels)[8] = GetTextSpans(textColour, backgroundColour)->pixels;
+	unsigned char* dest = framebuffer + y * pitch + x * (bpp >> 3);
+	switch (bpp)
+	{
+		case 32:
+			BlitTextRows<4>(dest, pitch, rows, glyphs, glyphCount, lastPixels, pixels);
+		break;
+		case 24:
+			BlitTextRows<3>(dest, pitch, rows, glyphs, glyphCount, lastPixels, pixels);
+		break;
+		case 16:
+			BlitTextRows<2>(dest, pitch, rows, glyphs, glyphCount, lastPixels, pixels);
+		break;
+		case 8:
+			BlitTextRows<1>(dest, pitch, rows, glyphs, glyphCount, lastPixels, pixels);
+		break;
 	}
+	Damage(x, y, x + pixelsVisible, y + rows);
+#endif
 }
 
 void Screen::PlotPixel(u32 x, u32 y, RGBA colour)
@@ -264,6 +604,7 @@ void Screen::PlotPixel(u32 x, u32 y, RGBA colour)
 		return;
 	int pixel_offset = (x * (bpp >> 3)) + (y * pitch);
 	(this->*Screen::plotPixelFn)(pixel_offset, colour);
+	Damage(x, y, x + 1, y + 1);
 }
 
 void Screen::DrawLine(u32 x1, u32 y1, u32 x2, u32 y2, RGBA colour)
@@ -279,19 +620,26 @@ void Screen::DrawLine(u32 x1, u32 y1, u32 x2, u32 y2, RGBA colour)
 	{
 		ox = ((dx0 * i) / eulerMax) + x1;
 		oy = ((dy0 * i) / eulerMax) + y1;
+		if ((u32)ox >= width || (u32)oy >= height)
+			continue;
 		int pixel_offset = (ox * (bpp >> 3)) + (oy * pitch);
 		(this->*Screen::plotPixelFn)(pixel_offset, colour);
 	}
+	Damage(x1 < x2 ? x1 : x2, y1 < y2 ? y1 : y2, (x1 < x2 ? x2 : x1) + 1, (y1 < y2 ? y2 : y1) + 1);
 }
 
 void Screen::DrawLineV(u32 x, u32 y1, u32 y2, RGBA colour)
 {
-	//ClipRect(x, y1, x, y2);
+	if (x >= width)
+		return;
+	if (y2 >= height)
+		y2 = height - 1;
 	for (u32 y = y1; y <= y2; ++y)
 	{
 		int pixel_offset = (x * (bpp >> 3)) + (y * pitch);
 		(this->*Screen::plotPixelFn)(pixel_offset, colour);
 	}
+	Damage(x, y1, x + 1, y2 + 1);
 }
 
 u32 Screen::PrintText(bool petscii, u32 x, u32 y, char *ptr, RGBA TxtColour, RGBA BkColour, bool measureOnly, u32* width, u32* height)
@@ -308,23 +656,27 @@ u32 Screen::PrintText(bool petscii, u32 x, u32 y, char *ptr, RGBA TxtColour, RGB
 
 	while (*ptr != 0)
 	{
-		char c = *ptr++;
-		if ((c != '\r') && (c != '\n'))
+		// Each line is drawn in one go, a pixel row at a time, rather than a character at a time.
+		u32 count = 0;
+		while (ptr[count] != 0 && ptr[count] != '\r' && ptr[count] != '\n')
+			count++;
+
+		if (count)
 		{
 			if (!measureOnly)
-			{
-				DrawRectangle(xCursor, yCursor, xCursor + BitFontWth, yCursor + fontHeight, BkColour);
-				WriteChar(petscii, xCursor, yCursor, c, TxtColour);
-			}
-			xCursor += BitFontWth;
+				DrawText(petscii, xCursor, yCursor, ptr, count, TxtColour, BkColour);
+			xCursor += count * BitFontWth;
 			if (width) *width = MAX(*width, (u32)MAX(0, xCursor));
+			ptr += count;
+			len += count;
 		}
 		else
 		{
+			ptr++;
 			xCursor = x;
 			yCursor += fontHeight;
+			len++;
 		}
-		len++;
 	}
 	if (height) *height = yCursor;
 
@@ -336,17 +688,61 @@ u32 Screen::MeasureText(bool petscii, char *ptr, u32* width, u32* height)
 	return PrintText(petscii, 0, 0, ptr, 0, 0, true, width, height);
 }
 
+// Converts a row of RGBA pixels to the framebuffer's format.
+template <u32 BYTES_PER_PIXEL>
+static void ConvertRow(unsigned char* dest, const u32* source, u32 count)
+{
+	if (BYTES_PER_PIXEL == 4)
+	{
+		memcpy(dest, source, count * 4);
+		return;
+	}
+
+	for (; count; --count, dest += BYTES_PER_PIXEL)
+		EncodePixel(dest, *source++, BYTES_PER_PIXEL * 8);
+}
+
 void Screen::PlotImage(u32* image, int x, int y, int w, int h)
 {
-	int px;
-	int py;
-	int i = 0;
-	for (py = 0; py < h; ++py)
+#if not defined(EXPERIMENTALZERO)
+	if (!opened)
+		return;
+
+	// Clip the image to the screen.
+	int left = x < 0 ? -x : 0;
+	int top = y < 0 ? -y : 0;
+	int right = x + w > (int)width ? (int)width - x : w;
+	int bottom = y + h > (int)height ? (int)height - y : h;
+	if (left >= right || top >= bottom)
+		return;
+
+	u32 bytesPerPixel = bpp >> 3;
+	u32 count = right - left;
+	const u32* source = image + top * w + left;
+	unsigned char* dest = framebuffer + (y + top) * pitch + (x + left) * bytesPerPixel;
+	for (int py = top; py < bottom; ++py, source += w, dest += pitch)
 	{
-		for (px = 0; px < w; ++px)
+		switch (bpp)
 		{
-			PlotPixel(x + px, y + py, image[i++]);
+			case 32:
+				ConvertRow<4>(dest, source, count);
+			break;
+			case 24:
+				ConvertRow<3>(dest, source, count);
+			break;
+			case 16:
+				ConvertRow<2>(dest, source, count);
+			break;
+			case 8:
+				ConvertRow<1>(dest, source, count);
+			break;
+			default:
+				for (u32 px = 0; px < count; ++px)
+					(this->*Screen::plotPixelFn)((x + left + px) * bytesPerPixel + (y + py) * pitch, source[px]);
+			break;
 		}
 	}
+	Damage(x + left, y + top, x + right, y + bottom);
+#endif
 }
 
@@ -27,7 +27,19 @@ class Screen : public ScreenBase
 public:
 	Screen()
 		: ScreenBase()
+		, nextTextSpans(0)
+		, pages(0)
+		, pageCount(0)
+		, visiblePage(0)
+		, tileStale(0)
+		, tilesAcross(0)
+		, tilesDown(0)
+		, compositing(false)
+		, damaged(0)
+		, flipTime(0)
 	{
+		for (u32 index = 0; index < TEXT_SPANS_CACHED; ++index)
+			textSpans[index].bpp = 0;
 	}
 
 	void Open(u32 width, u32 height, u32 colourDepth);
@@ -56,7 +68,14 @@ public:
 	u32 GetFontHeight();
 	u32 GetFontHeightDirectoryDisplay();
 
-	void SwapBuffers() {}
+	void SwapBuffers();
+
+	// Drawing goes to a shadow of the screen in cached memory and the tiles it touches are marked as stale.
+	// Until the compositor is enabled they are copied to the screen straight away.
+	// After that Composite() (called regularly by the core that owns the screen) copies them to the hidden page and flips to it.
+	void EnableCompositor() { compositing = pageCount == 2; }
+	bool Composite();
+
 private:
 
 	typedef void (Screen::*PlotPixelFunction)(u32 pixel_offset, RGBA Colour);
@@ -68,6 +87,43 @@ private:
 	void PlotPixel16(u32 pixel_offset, RGBA Colour);
 	void PlotPixel8(u32 pixel_offset, RGBA Colour);
 
+	// The 8 pixels of a font row for each of the 256 patterns its bits can make,
+	// already in the framebuffer's format for one text and background colour.
+	struct TextSpans
+	{
+		RGBA textColour;
+		RGBA backgroundColour;
+		u32 bpp;
+		u32 pixels[256][8];	// 8 pixels of up to 4 bytes
+	};
+
+	enum { TEXT_SPANS_CACHED = 4 };
+
+	const TextSpans* GetTextSpans(RGBA textColour, RGBA backgroundColour);
+	void DrawText(bool petscii, u32 x, u32 y, const char* text, u32 count, RGBA textColour, RGBA backgroundColour);
+
+	TextSpans textSpans[TEXT_SPANS_CACHED];
+	u32 nextTextSpans;
+
+	enum
+	{
+		TILE_WIDTH = 64,
+		TILE_HEIGHT = 16
+	};
+
+	void Damage(u32 x1, u32 y1, u32 x2, u32 y2);
+	void PresentTile(u32 tile, u32 page);
+
+	unsigned char* pages;		// The GPU's framebuffer (pageCount screens one above the other). framebuffer is the shadow.
+	u32 pageCount;
+	u32 visiblePage;
+	volatile u8* tileStale;		// A bit for each page the tile still has to be copied to (set by the drawing functions)
+	u32 tilesAcross;
+	u32 tilesDown;
+	bool compositing;
+	volatile u32 damaged;
+	u32 flipTime;
+
 	float scaleX;
 	float scaleY;
 };
@@ -75,6 +75,14 @@ public:
 	virtual void SwapBuffers() = 0;
 	virtual void RefreshRows(u32 start, u32 amountOfRows) {}
 
+	// For screens that can be drawn ahead of time and then shown without waiting on the display (ie while emulating).
+	// GetFrameSize() is 0 if the screen can't be saved. BeginRefresh() shows the given saved frame (or the current one)
+	// and RefreshStep() must then be called until it returns true.
+	virtual u32 GetFrameSize() { return 0; }
+	virtual void SaveFrame(void* frame) {}
+	virtual void BeginRefresh(const void* frame = 0) { SwapBuffers(); }
+	virtual bool RefreshStep() { return true; }
+
 	virtual bool IsLCD() { return false; };
 	virtual bool UseCBMFont() { return false; };
 
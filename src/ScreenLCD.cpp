@@ -130,6 +130,26 @@ void ScreenLCD::SwapBuffers()
 	ssd1306->RefreshScreen();
 }
 
+u32 ScreenLCD::GetFrameSize()
+{
+	return ssd1306 ? ssd1306->GetFrameSize() : 0;
+}
+
+void ScreenLCD::SaveFrame(void* frame)
+{
+	ssd1306->SaveFrame(frame);
+}
+
+void ScreenLCD::BeginRefresh(const void* frame)
+{
+	ssd1306->BeginRefresh(frame);
+}
+
+bool ScreenLCD::RefreshStep()
+{
+	return ssd1306->RefreshStep();
+}
+
 void ScreenLCD::RefreshRows(u32 start, u32 amountOfRows)
 {
 	if (ssd1306)
@@ -59,6 +59,12 @@ public:
 	void RefreshScreen();
 
 	void RefreshRows(u32 start, u32 amountOfRows);
+
+	u32 GetFrameSize();
+	void SaveFrame(void* frame);
+	void BeginRefresh(const void* frame = 0);
+	bool RefreshStep();
+
 	bool IsLCD();
 	bool UseCBMFont();
 private:
@@ -0,0 +1,81 @@
+// Pi1541 - A Commodore 1541 disk drive emulator
+// Copyright(C) 2018 Stephen White
+//
+// This file is part of Pi1541.
+//
+// Pi1541 is free software : you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Pi1541 is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Pi1541. If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <string.h>
+#include "types.h"
+
+// Bump this whenever a SaveState()/LoadState() changes what it stores so that old snapshots (eg on the SD card) are ignored.
+#define SNAPSHOT_VERSION 1
+
+// A buffer that emulated chips serialise their state to (SaveState) and restore it from (LoadState).
+// Only the state is stored; the wiring between the objects (callbacks, interrupt lines, disk image etc) is left as it is.
+// Reading or writing past the end of the buffer sets Overflowed() rather than failing immediately.
+class Snapshot
+{
+public:
+	Snapshot(void* buffer, u32 capacity)
+		: buffer((u8*)buffer)
+		, capacity(capacity)
+		, position(0)
+		, overflowed(false)
+	{
+	}
+
+	void Write(const void* data, u32 size)
+	{
+		if (position + size > capacity)
+		{
+			overflowed = true;
+			return;
+		}
+		memcpy(buffer + position, data, size);
+		position += size;
+	}
+
+	void Read(void* data, u32 size)
+	{
+		if (position + size > capacity)
+		{
+			overflowed = true;
+			memset(data, 0, size);
+			return;
+		}
+		memcpy(data, buffer + position, size);
+		position += size;
+	}
+
+	template <typename T> inline void Write(const T& value) { Write(&value, sizeof(T)); }
+	template <typename T> inline void Read(T& value) { Read(&value, sizeof(T)); }
+
+	inline void Rewind() { position = 0; overflowed = false; }
+
+	inline u8* Data() const { return buffer; }
+	inline u32 Size() const { return position; }
+	inline bool Overflowed() const { return overflowed; }
+
+private:
+	u8* buffer;
+	u32 capacity;
+	u32 position;
+	bool overflowed;
+};
+
+#endif
@@ -0,0 +1,97 @@
+// Pi1541 - A Commodore 1541 disk drive emulator
+// Copyright(C) 2018 Stephen White
+//
+// This file is part of Pi1541.
+//
+// Pi1541 is free software : you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Pi1541 is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Pi1541. If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef SYNCSTATS_H
+#define SYNCSTATS_H
+
+#include <stdio.h>
+#include "types.h"
+
+// Records how well an emulation loop is keeping up with the 1MHz clock.
+// Updated by the emulation core every cycle and read by the other cores (each count is a single aligned word).
+class SyncStats
+{
+public:
+	enum
+	{
+		// Slack is the number of times the sync loop had to poll the clock before the cycle ended.
+		// Bucket 0 is no slack (we only just made it), bucket n is 2^(n-1) to 2^n - 1 polls.
+		SLACK_BUCKETS = 8
+	};
+
+	SyncStats()
+	{
+		Reset();
+	}
+
+	void Reset()
+	{
+		cycles = 0;
+		lostCycles = 0;
+		worstOverrun = 0;
+		for (int bucket = 0; bucket < SLACK_BUCKETS; ++bucket)
+			slack[bucket] = 0;
+	}
+
+	// The cycle overran by this many sync clock ticks, losing this many whole cycles.
+	inline void Overrun(u32 ticks, u32 lost)
+	{
+		lostCycles += lost;
+		if (ticks > worstOverrun)
+			worstOverrun = ticks;
+	}
+
+	// The cycle ended after this many extra polls of the sync clock.
+	inline void Cycle(u32 polls)
+	{
+		int bucket = polls ? 32 - __builtin_clz(polls) : 0;
+		if (bucket >= SLACK_BUCKETS)
+			bucket = SLACK_BUCKETS - 1;
+		slack[bucket]++;
+		cycles++;
+	}
+
+	inline u32 GetCycles() const { return cycles; }
+	inline u32 GetLostCycles() const { return lostCycles; }
+	inline u32 GetWorstOverrun() const { return worstOverrun; }
+	inline u32 GetSlack(int bucket) const { return slack[bucket]; }
+
+	void Dump(const char* name) const
+	{
+		printf("%s sync: cycles %u lost %u worst overrun %u\r\n", name, (unsigned)cycles, (unsigned)lostCycles, (unsigned)worstOverrun);
+		printf("  slack polls:");
+		for (int bucket = 0; bucket < SLACK_BUCKETS; ++bucket)
+		{
+			if (bucket == 0)
+				printf(" 0=%u", (unsigned)slack[bucket]);
+			else if (bucket == SLACK_BUCKETS - 1)
+				printf(" %u+=%u", 1u << (bucket - 1), (unsigned)slack[bucket]);
+			else
+				printf(" %u-%u=%u", 1u << (bucket - 1), (2u << (bucket - 1)) - 1, (unsigned)slack[bucket]);
+		}
+		printf("\r\n");
+	}
+
+private:
+	volatile u32 cycles;
+	volatile u32 lostCycles;
+	volatile u32 worstOverrun;	// In sync clock ticks (system timer us, or ARM cycles over the 1us budget on the Pi 2)
+	volatile u32 slack[SLACK_BUCKETS];
+};
+
+#endif
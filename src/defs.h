@@ -3,6 +3,24 @@
 
 #include "debug.h"
 #define PI1581SUPPORT 1
+
+// Skip the per cycle VIA update while only its timers are counting down.
+// The counters are caught up when the registers are next accessed.
+#define VIA_LAZY_TIMERS
+// Likewise skip the per cycle CIA update on the 1581 while only its phi2 timers are counting down.
+#define CIA_LAZY_TIMERS
+// Skip the per 8MHz cycle WD177x update until its next byte, index, delay or settle event.
+#define WD177X_SCHEDULED_EVENTS
+// Accumulate the ARM performance counters for each emulated subsystem and print a summary (see Profile.h).
+//#define PROFILE
+// Count the emulated 6502 instructions by address and print/save the hot spots when emulation exits (see PCHistogram.h).
+//#define PC_HISTOGRAM
+// Snapshot the 1541 once it has finished its self test and restore that rather than running FAST_BOOT_CYCLES on every emulation entry.
+#define BOOT_SNAPSHOTS
+// Run work that does not need the calling core (eg GCR encoding the disks going into the caddy) on the idle cores 2 and 3 (see JobSystem.h).
+#if defined(RPI2) || defined(RPI3)
+#define BACKGROUND_JOBS
+#endif
 // Indicates a Pi with the 40 pin GPIO connector
 // so that additional functionality (e.g. test pins) can be enabled
 #if defined(RPIZERO) || defined(RPI1BPLUS) || defined(RPI2) || defined(RPI3)
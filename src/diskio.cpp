@@ -9,6 +9,7 @@
 
 #include "diskio.h"		/* FatFs lower layer API */
 #include "debug.h"
+#include <string.h>
 extern "C"
 {
 #include <uspi.h>
@@ -51,6 +52,126 @@ size_t sd_write(uint8_t *buf, size_t buf_size, uint32_t block_no)
 	return pEMMC->DoWrite(buf, buf_size, block_no);
 }
 
+/*-----------------------------------------------------------------------*/
+/* USB transfer batching                                                 */
+/*-----------------------------------------------------------------------*/
+/* Each bulk only transfer costs a command and a status phase on top of  */
+/* the data, so it pays to move more sectors per transfer;-              */
+/* - small reads are rounded up to a read ahead run held in usbReadCache */
+/*   (the run doubles while FatFs keeps reading sequentially)            */
+/* - consecutive writes are gathered into one transfer which is sent     */
+/*   when FatFs syncs, reads, or writes somewhere else                   */
+/*-----------------------------------------------------------------------*/
+
+#define USB_READ_AHEAD_MIN		8		/* Sectors */
+#define USB_READ_AHEAD_MAX		64
+#define USB_WRITE_GATHER_MAX	64
+
+struct USBSectorRun
+{
+	int device;		/* -1 if the run is empty */
+	DWORD sector;
+	UINT count;
+	BYTE data[USB_READ_AHEAD_MAX << UMSD_BLOCK_SHIFT] __attribute__((aligned(64)));
+};
+
+static USBSectorRun usbReadCache = { -1 };
+static USBSectorRun usbWriteGather = { -1 };
+static DWORD usbNextSequentialSector;
+static UINT usbReadAhead = USB_READ_AHEAD_MIN;
+
+static bool usb_transfer_read(unsigned device, BYTE* buff, DWORD sector, UINT count)
+{
+	unsigned bytes = (unsigned)USPiMassStorageDeviceRead(((unsigned long long)sector) << UMSD_BLOCK_SHIFT, buff, count << UMSD_BLOCK_SHIFT, device);
+	return bytes == (count << UMSD_BLOCK_SHIFT);
+}
+
+static bool usb_transfer_write(unsigned device, const BYTE* buff, DWORD sector, UINT count)
+{
+	unsigned bytes = (unsigned)USPiMassStorageDeviceWrite(((unsigned long long)sector) << UMSD_BLOCK_SHIFT, buff, count << UMSD_BLOCK_SHIFT, device);
+	//DEBUG_LOG("USB disk_write %d %d\r\n", (int)sector, (int)count);
+	return bytes == (count << UMSD_BLOCK_SHIFT);
+}
+
+static bool usb_flush_writes()
+{
+	bool ok = true;
+	if (usbWriteGather.device >= 0)
+	{
+		ok = usb_transfer_write(usbWriteGather.device, usbWriteGather.data, usbWriteGather.sector, usbWriteGather.count);
+		usbWriteGather.device = -1;
+	}
+	return ok;
+}
+
+static DRESULT usb_read(unsigned device, BYTE* buff, DWORD sector, UINT count)
+{
+	if (!usb_flush_writes())
+		return RES_ERROR;
+
+	USBSectorRun& cache = usbReadCache;
+	if (cache.device == (int)device && sector >= cache.sector && sector + count <= cache.sector + cache.count)
+	{
+		memcpy(buff, cache.data + ((sector - cache.sector) << UMSD_BLOCK_SHIFT), count << UMSD_BLOCK_SHIFT);
+		usbNextSequentialSector = sector + count;
+		return RES_OK;
+	}
+
+	if (sector == usbNextSequentialSector)
+	{
+		if (usbReadAhead < USB_READ_AHEAD_MAX)
+			usbReadAhead <<= 1;
+	}
+	else
+	{
+		usbReadAhead = USB_READ_AHEAD_MIN;
+	}
+	usbNextSequentialSector = sector + count;
+
+	if (count < usbReadAhead)
+	{
+		// The read ahead may run off the end of the device; then just read what was asked for.
+		cache.device = -1;
+		if (usb_transfer_read(device, cache.data, sector, usbReadAhead))
+		{
+			cache.device = device;
+			cache.sector = sector;
+			cache.count = usbReadAhead;
+			memcpy(buff, cache.data, count << UMSD_BLOCK_SHIFT);
+			return RES_OK;
+		}
+	}
+
+	return usb_transfer_read(device, buff, sector, count) ? RES_OK : RES_ERROR;
+}
+
+static DRESULT usb_write(unsigned device, const BYTE* buff, DWORD sector, UINT count)
+{
+	USBSectorRun& cache = usbReadCache;
+	if (cache.device == (int)device && sector < cache.sector + cache.count && sector + count > cache.sector)
+		cache.device = -1;
+
+	USBSectorRun& gather = usbWriteGather;
+	if (gather.device >= 0 && (gather.device != (int)device || gather.sector + gather.count != sector || gather.count + count > USB_WRITE_GATHER_MAX))
+	{
+		if (!usb_flush_writes())
+			return RES_ERROR;
+	}
+
+	if (count >= USB_WRITE_GATHER_MAX)
+		return usb_transfer_write(device, buff, sector, count) ? RES_OK : RES_ERROR;
+
+	if (gather.device < 0)
+	{
+		gather.device = device;
+		gather.sector = sector;
+		gather.count = 0;
+	}
+	memcpy(gather.data + (gather.count << UMSD_BLOCK_SHIFT), buff, count << UMSD_BLOCK_SHIFT);
+	gather.count += count;
+	return RES_OK;
+}
+
 
 /*-----------------------------------------------------------------------*/
 /* Get Drive Status                                                      */
@@ -157,12 +278,7 @@ DRESULT disk_read (
 	}
 	else
 	{
-		unsigned bytes = (unsigned)USPiMassStorageDeviceRead((unsigned long long )(sector << UMSD_BLOCK_SHIFT), buff, count << UMSD_BLOCK_SHIFT, pdrv - 1);
-
-		if (bytes != (count << UMSD_BLOCK_SHIFT))
-			return RES_ERROR;
-
-		return RES_OK;
+		return usb_read(pdrv - 1, buff, sector, count);
 	}
 
 	return RES_PARERR;
@@ -196,13 +312,7 @@ DRESULT disk_write (
 	}
 	else
 	{
-		unsigned bytes = (unsigned)USPiMassStorageDeviceWrite(sector << UMSD_BLOCK_SHIFT, buff, count << UMSD_BLOCK_SHIFT, pdrv - 1);
-
-		//DEBUG_LOG("USB disk_write %d %d\r\n", (int)sector, (int)count);
-		if (bytes != (count << UMSD_BLOCK_SHIFT))
-			return RES_ERROR;
-
-		return RES_OK;
+		return usb_write(pdrv - 1, buff, sector, count);
 	}
 
 	return RES_PARERR;
@@ -243,6 +353,14 @@ DRESULT disk_ioctl (
 	//	return res;
 	//}
 
+	if (cmd == CTRL_SYNC)
+	{
+		// SD card writes are done by the time disk_write() returns; USB ones may still be being gathered.
+		if (pdrv != 0 && !usb_flush_writes())
+			return RES_ERROR;
+		return RES_OK;
+	}
+
 	return RES_PARERR;
 }
 
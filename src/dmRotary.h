@@ -79,10 +79,11 @@ public:
 
     bool GetState() const { return _currentState; }
 
-    void Update(bool state)
+    // weight is the number of samples this one stands for (when polled less often than usual)
+    void Update(bool state, int weight = 1)
     {
 
-		_count += state ? 1 : -1;
+		_count += state ? weight : -weight;
 
         bool newState = _currentState;
 
@@ -198,6 +199,9 @@ public:
 //
 //  Note, the Poll() logic depends on frequent polling of the encoder.  Calling
 //  Poll() as often as possible/permissable will yield better decode results.
+//  If it is polled at a fixed slower rate pass the number of usual polls each
+//  one stands for as elapsed so that the pins are still debounced over the
+//  same time.
 //
 //  Any event detected by the polling logic will be returned as the result
 //  from the polling method as a rotary_result_t.  The controlling logic can
@@ -243,7 +247,7 @@ public:
     void Initialize(rpi_gpio_pin_t clkGpioPin, rpi_gpio_pin_t dtGpioPin, rpi_gpio_pin_t swGpioPin);
 
     rotary_result_t Poll();
-    rotary_result_t Poll(unsigned gplev0);
+    rotary_result_t Poll(unsigned gplev0, int elapsed = 1);
 
 };
 
@@ -80,7 +80,7 @@ bool IEC_Bus::rotaryEncoderEnable;
 //ROTARY: Added for rotary encoder inversion (Issue#185) - 08/13/2020 by Geo...
 bool IEC_Bus::rotaryEncoderInvert;
 
-void IEC_Bus::ReadGPIOUserInput()
+void IEC_Bus::ReadGPIOUserInput(unsigned levels, u32 elapsed)
 {
 	//ROTARY: Added for rotary encoder support - 09/05/2019 by Geo...
 	if (IEC_Bus::rotaryEncoderEnable == true)
@@ -98,7 +98,7 @@ void IEC_Bus::ReadGPIOUserInput()
 		//       input button registers to reflect the desired action, and allow the
 		//       original processing logic to do it's work.
 		//
-		rotary_result_t rotaryResult = IEC_Bus::rotaryEncoder.Poll(gplev0);
+		rotary_result_t rotaryResult = IEC_Bus::rotaryEncoder.Poll(levels, elapsed);
 		switch (rotaryResult)
 		{
 
@@ -122,8 +122,8 @@ void IEC_Bus::ReadGPIOUserInput()
 
 		}
 
-		UpdateButton(indexBack, gplev0);
-		UpdateButton(indexInsert, gplev0);
+		UpdateButton(indexBack, levels, elapsed);
+		UpdateButton(indexInsert, levels, elapsed);
 	}
 	else // Unmolested original logic
 	{
@@ -131,7 +131,7 @@ void IEC_Bus::ReadGPIOUserInput()
 		int index;
 		for (index = 0; index < buttonCount; ++index)
 		{
-			UpdateButton(index, gplev0);
+			UpdateButton(index, levels, elapsed);
 		}
 
 	}
@@ -142,7 +142,7 @@ void IEC_Bus::ReadGPIOUserInput()
 void IEC_Bus::ReadBrowseMode(void)
 {
 	gplev0 = read32(ARM_GPIO_GPLEV0);
-	ReadGPIOUserInput();
+	ReadGPIOUserInput(gplev0);
 
 	bool ATNIn = (gplev0 & PIGPIO_MASK_IN_ATN) == (invertIECInputs ? PIGPIO_MASK_IN_ATN : 0);
 	if (PI_Atn != ATNIn)
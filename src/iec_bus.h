@@ -400,7 +400,8 @@ public:
 	}
 #endif
 
-	static void UpdateButton(int index, unsigned gplev0)
+	// The thresholds are in us so elapsed is the time since the button was last updated.
+	static void UpdateButton(int index, unsigned gplev0, u32 elapsed)
 	{
 		bool inputcurrent = (gplev0 & ButtonPinFlags[index]) == 0;
 
@@ -409,15 +410,16 @@ public:
 
 		if (inputcurrent)
 		{
-			validInputCount[index]++;
-			if (validInputCount[index] == INPUT_BUTTON_DEBOUNCE_THRESHOLD)
+			u32 count = validInputCount[index];
+			validInputCount[index] += elapsed;
+			if (count < INPUT_BUTTON_DEBOUNCE_THRESHOLD && validInputCount[index] >= INPUT_BUTTON_DEBOUNCE_THRESHOLD)
 			{
 				InputButton[index] = true;
 				inputRepeatThreshold[index] = INPUT_BUTTON_DEBOUNCE_THRESHOLD + INPUT_BUTTON_REPEAT_THRESHOLD;
 				inputRepeat[index]++;
 			}
 
-			if (validInputCount[index] == inputRepeatThreshold[index])
+			if (validInputCount[index] >= inputRepeatThreshold[index])
 			{
 				inputRepeat[index]++;
 				inputRepeatThreshold[index] += INPUT_BUTTON_REPEAT_THRESHOLD / inputRepeat[index];
@@ -475,7 +477,8 @@ public:
 
 
 	static void ReadBrowseMode(void);
-	static void ReadGPIOUserInput(void);
+	// Update the buttons (or rotary encoder) from the GPIO levels, elapsed us after the last update.
+	static void ReadGPIOUserInput(unsigned levels, u32 elapsed = 1);
 	static void ReadEmulationMode1541(void);
 	static void ReadEmulationMode1581(void);
 
@@ -0,0 +1,91 @@
+// Pi1541 - A Commodore 1541 disk drive emulator
+// Copyright(C) 2018 Stephen White
+//
+// This file is part of Pi1541.
+//
+// Pi1541 is free software : you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Pi1541 is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Pi1541. If not, see <http://www.gnu.org/licenses/>.
+
+#include <stdio.h>
+#include <stdarg.h>
+#include "logring.h"
+#include "startup.h"
+
+typedef struct
+{
+	const char* format;
+	unsigned args[LOG_RING_MAX_ARGS];
+} log_record_t;
+
+static log_record_t records[LOG_RING_RECORDS];
+static volatile unsigned head;	// Only written by the writer
+static volatile unsigned tail;	// Only written by the drainer
+static volatile unsigned dropped;
+static unsigned droppedReported;
+
+void log_ring_write(int num_args, const char* format, ...)
+{
+	unsigned next = (head + 1) & (LOG_RING_RECORDS - 1);
+	log_record_t* record;
+	va_list args;
+	int arg;
+
+	if (next == tail)
+	{
+		dropped++;
+		return;
+	}
+
+	record = &records[head];
+	record->format = format;
+	va_start(args, format);
+	for (arg = 0; arg < num_args; ++arg)
+		record->args[arg] = va_arg(args, unsigned);
+	va_end(args);
+
+	// The record must be visible to the other core before it sees the new head.
+	_data_memory_barrier();
+	head = next;
+}
+
+int log_ring_drain(int max_records)
+{
+	int count = 0;
+
+	while (count < max_records && tail != head)
+	{
+		log_record_t* record;
+
+		// Don't read the record until we have seen the head that published it.
+		_data_memory_barrier();
+		record = &records[tail];
+		// Unused arguments are passed anyway; printf will ignore them.
+		printf(record->format, record->args[0], record->args[1], record->args[2], record->args[3]);
+		// Finished with the record before handing the slot back to the writer.
+		_data_memory_barrier();
+		tail = (tail + 1) & (LOG_RING_RECORDS - 1);
+		count++;
+	}
+
+	if (dropped != droppedReported)
+	{
+		droppedReported = dropped;
+		printf("log ring: %u records dropped\r\n", droppedReported);
+	}
+	return count;
+}
+
+unsigned log_ring_dropped(void)
+{
+	return dropped;
+}
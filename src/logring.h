@@ -0,0 +1,57 @@
+// Pi1541 - A Commodore 1541 disk drive emulator
+// Copyright(C) 2018 Stephen White
+//
+// This file is part of Pi1541.
+//
+// Pi1541 is free software : you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Pi1541 is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Pi1541. If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef LOGRING_H
+#define LOGRING_H
+
+// Logging for code that cannot wait on the UART (eg the emulation loops).
+// FAST_LOG() only copies the format pointer and up to LOG_RING_MAX_ARGS 32 bit arguments into a ring of records.
+// The formatting and the UART writes are done later by log_ring_drain() on another core (or once emulation has stopped).
+//
+// There must only be one core writing to the ring (the emulation core) and one core draining it.
+// As the arguments are formatted later;-
+//	- the format string must be a literal
+//	- %s arguments must point to strings that are still valid when drained
+//	- arguments must fit in 32 bits (no floats or 64 bit values)
+// If the ring is full the record is dropped (and counted) rather than stalling the writer.
+
+#define LOG_RING_MAX_ARGS 4
+#define LOG_RING_RECORDS 256	// Must be a power of 2
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+	void log_ring_write(int num_args, const char* format, ...);
+
+	// Prints up to max_records records to the UART. Returns how many were printed.
+	int log_ring_drain(int max_records);
+
+	// Number of records lost because the ring was full.
+	unsigned log_ring_dropped(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#define LOG_RING_NARGS(...) LOG_RING_NARGS_(__VA_ARGS__, 4, 3, 2, 1, 0)
+#define LOG_RING_NARGS_(format, a0, a1, a2, a3, n, ...) n
+
+#define FAST_LOG(...) log_ring_write(LOG_RING_NARGS(__VA_ARGS__), __VA_ARGS__)
+
+#endif
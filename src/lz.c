@@ -88,6 +88,10 @@
    you. */
 #define LZ_MAX_OFFSET 100000
 
+/* Number of bits in the hash of three symbols used by LZ_CompressHash().
+   The hash table takes (1 << LZ_HASH_BITS) unsigned integers. */
+#define LZ_HASH_BITS 15
+
 
 
 /*************************************************************************
@@ -102,6 +106,11 @@
 #include <ctype.h>
 #include "lz.h"
 
+/* The streaming decoder must be able to reach back as far as we encode */
+#if LZ_MAX_OFFSET > LZ_WINDOW_SIZE
+#error LZ_WINDOW_SIZE is smaller than LZ_MAX_OFFSET
+#endif
+
 /*************************************************************************
 * _LZ_StringCompare() - Return maximum length string match.
 *************************************************************************/
@@ -181,6 +190,89 @@ static int _LZ_ReadVarSize( unsigned int * x, unsigned char * buf )
 
 
 
+/*************************************************************************
+* _LZ_Hash3() - Hash the three symbols starting at buf.
+*************************************************************************/
+
+static unsigned int _LZ_Hash3( unsigned char * buf )
+{
+	unsigned int x;
+
+	x = (((unsigned int) buf[ 0 ]) << 16) | (((unsigned int) buf[ 1 ]) << 8) |
+		((unsigned int) buf[ 2 ]);
+	return (x * 2654435761U) >> (32 - LZ_HASH_BITS);
+}
+
+
+/*************************************************************************
+* _LZ_CopyMatch() - Copy a string reference from the history window.
+* Overlapping copies with an offset of at least one word are still done
+* a word at a time, since every word read has then already been written.
+*************************************************************************/
+
+typedef unsigned int __attribute__((aligned(1), may_alias)) _LZ_Word;
+
+static void _LZ_CopyMatch( unsigned char * dst, unsigned int offset,
+  unsigned int length )
+{
+	unsigned char *src = dst - offset;
+
+	if( offset >= length )
+	{
+		/* Source and destination do not overlap */
+		memcpy( dst, src, length );
+	}
+	else if( offset == 1 )
+	{
+		/* Run of a single symbol (GCR sync and gap runs end up here) */
+		memset( dst, *src, length );
+	}
+	else
+	{
+		if( offset >= sizeof( _LZ_Word ) )
+		{
+			while( length >= sizeof( _LZ_Word ) )
+			{
+				*(_LZ_Word *) dst = *(const _LZ_Word *) src;
+				dst += sizeof( _LZ_Word );
+				src += sizeof( _LZ_Word );
+				length -= sizeof( _LZ_Word );
+			}
+		}
+		while( length -- )
+		{
+			*dst ++ = *src ++;
+		}
+	}
+}
+
+
+/*************************************************************************
+* _LZ_WindowWrite() - Append bytes to the circular history window used
+* by the streaming decoder.
+*************************************************************************/
+
+static void _LZ_WindowWrite( unsigned char * window, unsigned int pos,
+  unsigned char * src, unsigned int size )
+{
+	unsigned int start, part;
+
+	/* Only the most recent LZ_WINDOW_SIZE bytes can ever be referenced */
+	if( size > LZ_WINDOW_SIZE )
+	{
+		src += size - LZ_WINDOW_SIZE;
+		pos += size - LZ_WINDOW_SIZE;
+		size = LZ_WINDOW_SIZE;
+	}
+
+	start = pos & (LZ_WINDOW_SIZE - 1);
+	part = LZ_WINDOW_SIZE - start;
+	if( part > size ) part = size;
+	memcpy( &window[ start ], src, part );
+	memcpy( window, &src[ part ], size - part );
+}
+
+
 /*************************************************************************
 *                            PUBLIC FUNCTIONS                            *
 *************************************************************************/
@@ -348,7 +440,7 @@ int LZ_CompressFast( unsigned char *in, unsigned char *out, unsigned int insize)
 		return 0;
 	}
 
-	if(!(work = malloc(insize+65536 * sizeof(unsigned int))))
+	if(!(work = malloc((insize+65536) * sizeof(unsigned int))))
 	{
 		//printf("Could not allocate compression buffer\n");
 		//exit(0);
@@ -493,6 +585,187 @@ int LZ_CompressFast( unsigned char *in, unsigned char *out, unsigned int insize)
 }
 
 
+/*************************************************************************
+* LZ_CompressHash() - Compress a block of data using an LZ77 coder.
+* Candidate strings are found through a hash table of three symbol
+* prefixes chained over the history window, and string references may
+* overlap the data they produce (long sync and gap runs become a single
+* reference). The output is read by all of the decoders in this file.
+*  in     - Input (uncompressed) buffer.
+*  out    - Output (compressed) buffer. This buffer must be 0.4% larger
+*           than the input buffer, plus one byte.
+*  insize - Number of input bytes.
+*  effort - Maximum number of candidates examined per position. Higher
+*           values give better compression at the cost of speed.
+* The function returns the size of the compressed data.
+*************************************************************************/
+
+int LZ_CompressHash( unsigned char *in, unsigned char *out, unsigned int insize,
+  unsigned int effort )
+{
+	unsigned char marker, symbol;
+	unsigned int  inpos, outpos, bytesleft, i, index, hash, tries;
+	unsigned int  bestoffset;
+	unsigned int  length, bestlength;
+	unsigned int  histogram[ 256 ], *head, *chain;
+	unsigned char *ptr1, *ptr2;
+	unsigned int *work;
+
+	/* Do we have anything to compress? */
+	if( insize < 1 )
+	{
+		return 0;
+	}
+
+	if(!(work = malloc(((1 << LZ_HASH_BITS) + LZ_WINDOW_SIZE) * sizeof(unsigned int))))
+	{
+		return 0;
+	}
+
+	/* Assign arrays to the working area. head[h] is the most recent
+	   position whose three symbols hash to h, and chain[] links each
+	   position to the previous one with the same hash. Positions further
+	   back than LZ_MAX_OFFSET are never followed, so chain[] only needs
+	   to cover the history window. */
+	head = work;
+	chain = &work[ 1 << LZ_HASH_BITS ];
+	for( i = 0; i < (1 << LZ_HASH_BITS); ++ i )
+	{
+		head[ i ] = 0xffffffff;
+	}
+
+	if( effort < 1 )
+	{
+		effort = 1;
+	}
+
+	/* Create histogram */
+	for( i = 0; i < 256; ++ i )
+	{
+		histogram[ i ] = 0;
+	}
+	for( i = 0; i < insize; ++ i )
+	{
+		++ histogram[ in[ i ] ];
+	}
+
+	/* Find the least common byte, and use it as the marker symbol */
+	marker = 0;
+	for( i = 1; i < 256; ++ i )
+	{
+		if( histogram[ i ] < histogram[ marker ] )
+		{
+			marker = (unsigned char) i;
+		}
+	}
+
+	/* Remember the marker symbol for the decoder */
+	out[ 0 ] = marker;
+
+	/* Start of compression */
+	inpos = 0;
+	outpos = 1;
+
+	/* Main compression loop */
+	bytesleft = insize;
+	while( bytesleft > 3 )
+	{
+		/* Get pointer to current position */
+		ptr1 = &in[ inpos ];
+
+		/* Search the hash chain for maximum length string match */
+		bestlength = 3;
+		bestoffset = 0;
+		hash = _LZ_Hash3( ptr1 );
+		index = head[ hash ];
+		for( tries = effort; tries && (index != 0xffffffff) &&
+			((inpos - index) < LZ_MAX_OFFSET); -- tries )
+		{
+			/* Get pointer to candidate string */
+			ptr2 = &in[ index ];
+
+			/* Quickly determine if this is a candidate (for speed) */
+			if( (ptr2[ bestlength ] == ptr1[ bestlength ]) &&
+				(ptr2[ 0 ] == ptr1[ 0 ]) )
+			{
+				/* Count maximum length match at this offset */
+				length = _LZ_StringCompare( ptr1, ptr2, 0, bytesleft );
+
+				/* Better match than any previous match? */
+				if( length > bestlength )
+				{
+					bestlength = length;
+					bestoffset = inpos - index;
+					if( bestlength == bytesleft )
+					{
+						break;
+					}
+				}
+			}
+
+			/* Get next possible index from the chain */
+			index = chain[ index & (LZ_WINDOW_SIZE - 1) ];
+		}
+
+		/* Was there a good enough match? */
+		if( (bestlength >= 8) ||
+			((bestlength == 4) && (bestoffset <= 0x0000007f)) ||
+			((bestlength == 5) && (bestoffset <= 0x00003fff)) ||
+			((bestlength == 6) && (bestoffset <= 0x001fffff)) ||
+			((bestlength == 7) && (bestoffset <= 0x0fffffff)) )
+		{
+			out[ outpos ++ ] = (unsigned char) marker;
+			outpos += _LZ_WriteVarSize( bestlength, &out[ outpos ] );
+			outpos += _LZ_WriteVarSize( bestoffset, &out[ outpos ] );
+			length = bestlength;
+		}
+		else
+		{
+			/* Output single byte (or two bytes if marker byte) */
+			symbol = in[ inpos ];
+			out[ outpos ++ ] = symbol;
+			if( symbol == marker )
+			{
+				out[ outpos ++ ] = 0;
+			}
+			length = 1;
+		}
+
+		/* Add every position consumed to the hash chains */
+		bytesleft -= length;
+		while( length -- )
+		{
+			if( inpos + 2 < insize )
+			{
+				hash = _LZ_Hash3( &in[ inpos ] );
+				chain[ inpos & (LZ_WINDOW_SIZE - 1) ] = head[ hash ];
+				head[ hash ] = inpos;
+			}
+			++ inpos;
+		}
+	}
+
+	/* Dump remaining bytes, if any */
+	while( inpos < insize )
+	{
+		if( in[ inpos ] == marker )
+		{
+			out[ outpos ++ ] = marker;
+			out[ outpos ++ ] = 0;
+		}
+		else
+		{
+			out[ outpos ++ ] = in[ inpos ];
+		}
+		++ inpos;
+	}
+
+	free(work);
+
+	return outpos;
+}
+
+
 /*************************************************************************
 * LZ_Uncompress() - Uncompress a block of data using an LZ77 decoder.
 *  in      - Input (compressed) buffer.
@@ -554,3 +827,208 @@ int LZ_Uncompress( unsigned char *in, unsigned char *out, unsigned int insize )
 
 	return outpos;
 }
+
+
+/*************************************************************************
+* LZ_UncompressFast() - Uncompress a block of data using an LZ77 decoder.
+* Produces the same output as LZ_Uncompress(), but copies literal runs
+* and string references in blocks instead of one byte at a time.
+*  in      - Input (compressed) buffer.
+*  out     - Output (uncompressed) buffer. This buffer must be large
+*            enough to hold the uncompressed data.
+*  insize  - Number of input bytes.
+*************************************************************************/
+
+int LZ_UncompressFast( unsigned char *in, unsigned char *out, unsigned int insize )
+{
+	unsigned char marker, *ptr;
+	unsigned int  inpos, outpos, length, offset, run;
+
+	/* Do we have anything to uncompress? */
+	if( insize < 1 )
+	{
+		return 0;
+	}
+
+	/* Get marker symbol from input stream */
+	marker = in[ 0 ];
+	inpos = 1;
+
+	/* Main decompression loop */
+	outpos = 0;
+	while( inpos < insize )
+	{
+		/* Everything up to the next marker byte is a plain copy */
+		ptr = memchr( &in[ inpos ], marker, insize - inpos );
+		run = ptr ? (unsigned int) (ptr - &in[ inpos ]) : insize - inpos;
+		memcpy( &out[ outpos ], &in[ inpos ], run );
+		inpos += run;
+		outpos += run;
+		if( !ptr )
+		{
+			break;
+		}
+
+		/* We had a marker byte */
+		++ inpos;
+		if( in[ inpos ] == 0 )
+		{
+			/* It was a single occurrence of the marker byte */
+			out[ outpos ++ ] = marker;
+			++ inpos;
+		}
+		else
+		{
+			/* Extract true length and offset */
+			inpos += _LZ_ReadVarSize( &length, &in[ inpos ] );
+			inpos += _LZ_ReadVarSize( &offset, &in[ inpos ] );
+
+			/* Copy corresponding data from history window */
+			_LZ_CopyMatch( &out[ outpos ], offset, length );
+			outpos += length;
+		}
+	}
+
+	return outpos;
+}
+
+
+/*************************************************************************
+* LZ_UncompressStreamInit() - Prepare to uncompress a block of data in
+* pieces with LZ_UncompressStream().
+*  stream  - Stream state.
+*  in      - Input (compressed) buffer. Must stay valid while streaming.
+*  insize  - Number of input bytes.
+*  window  - History buffer of LZ_WINDOW_SIZE bytes.
+*************************************************************************/
+
+void LZ_UncompressStreamInit( LZ_Stream *stream, unsigned char *in,
+  unsigned int insize, unsigned char *window )
+{
+	stream->in = in;
+	stream->insize = insize;
+	stream->inpos = 1;
+	stream->marker = insize ? in[ 0 ] : 0;
+	stream->window = window;
+	stream->outpos = 0;
+	stream->length = 0;
+	stream->offset = 0;
+	stream->error = 0;
+}
+
+
+/*************************************************************************
+* LZ_UncompressStream() - Uncompress the next piece of a stream. Only the
+* last LZ_WINDOW_SIZE bytes of output are kept, so the whole uncompressed
+* data never needs to exist in memory at once.
+*  stream  - Stream state.
+*  out     - Output buffer for this piece.
+*  outsize - Number of bytes wanted.
+* The function returns the number of bytes produced. Fewer than outsize
+* means the end of the input was reached, or the data referenced further
+* back than the window holds (stream->error is then set).
+*************************************************************************/
+
+int LZ_UncompressStream( LZ_Stream *stream, unsigned char *out,
+  unsigned int outsize )
+{
+	unsigned char marker, symbol, *in, *window, *ptr;
+	unsigned int  inpos, insize, outpos, length, offset, count, run, i;
+
+	if( stream->error )
+	{
+		return 0;
+	}
+
+	in = stream->in;
+	insize = stream->insize;
+	inpos = stream->inpos;
+	marker = stream->marker;
+	window = stream->window;
+	outpos = stream->outpos;
+	length = stream->length;
+	offset = stream->offset;
+
+	count = 0;
+	while( count < outsize )
+	{
+		if( length )
+		{
+			/* Continue a string reference (it may span several pieces) */
+			run = outsize - count;
+			if( run > length ) run = length;
+			length -= run;
+			for( i = 0; i < run; ++ i )
+			{
+				symbol = window[ (outpos - offset) & (LZ_WINDOW_SIZE - 1) ];
+				window[ outpos & (LZ_WINDOW_SIZE - 1) ] = symbol;
+				out[ count ++ ] = symbol;
+				++ outpos;
+			}
+			continue;
+		}
+
+		if( inpos >= insize )
+		{
+			break;
+		}
+
+		/* Everything up to the next marker byte is a plain copy */
+		run = outsize - count;
+		if( run > insize - inpos ) run = insize - inpos;
+		ptr = memchr( &in[ inpos ], marker, run );
+		if( ptr ) run = (unsigned int) (ptr - &in[ inpos ]);
+		if( run )
+		{
+			memcpy( &out[ count ], &in[ inpos ], run );
+			_LZ_WindowWrite( window, outpos, &in[ inpos ], run );
+			inpos += run;
+			outpos += run;
+			count += run;
+			continue;
+		}
+
+		/* We had a marker byte */
+		if( inpos + 1 >= insize )
+		{
+			/* The input ends part way through a symbol */
+			break;
+		}
+		++ inpos;
+		if( in[ inpos ] == 0 )
+		{
+			/* It was a single occurrence of the marker byte */
+			window[ outpos & (LZ_WINDOW_SIZE - 1) ] = marker;
+			out[ count ++ ] = marker;
+			++ outpos;
+			++ inpos;
+		}
+		else
+		{
+			/* Extract true length and offset */
+			ptr = &in[ inpos - 1 ];
+			inpos += _LZ_ReadVarSize( &length, &in[ inpos ] );
+			inpos += _LZ_ReadVarSize( &offset, &in[ inpos ] );
+			if( inpos > insize )
+			{
+				/* The input ends part way through a string reference */
+				inpos = (unsigned int) (ptr - in);
+				length = 0;
+				break;
+			}
+			if( offset == 0 || offset > outpos || offset > LZ_WINDOW_SIZE )
+			{
+				stream->error = 1;
+				length = 0;
+				break;
+			}
+		}
+	}
+
+	stream->inpos = inpos;
+	stream->outpos = outpos;
+	stream->length = length;
+	stream->offset = offset;
+
+	return count;
+}
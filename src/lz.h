@@ -37,13 +37,49 @@ extern "C" {
 #endif
 
 
+/*************************************************************************
+* Constants
+*************************************************************************/
+
+/* Size of the history window needed by the streaming decoder. Must be a
+   power of two and no smaller than the largest offset the compressor
+   emits (LZ_MAX_OFFSET in lz.c). */
+#define LZ_WINDOW_SIZE 0x20000
+
+
+/*************************************************************************
+* Types
+*************************************************************************/
+
+/* State of a streaming decode. All fields are private to lz.c. */
+typedef struct
+{
+	unsigned char *in;
+	unsigned int  insize;
+	unsigned int  inpos;
+	unsigned char marker;
+	unsigned char *window;
+	unsigned int  outpos;
+	unsigned int  length;
+	unsigned int  offset;
+	int           error;
+} LZ_Stream;
+
+
 /*************************************************************************
 * Function prototypes
 *************************************************************************/
 
 int LZ_Compress( unsigned char *in, unsigned char *out, unsigned int insize );
 int LZ_CompressFast( unsigned char *in, unsigned char *out, unsigned int insize);
+int LZ_CompressHash( unsigned char *in, unsigned char *out, unsigned int insize,
+  unsigned int effort );
 int LZ_Uncompress( unsigned char *in, unsigned char *out, unsigned int insize );
+int LZ_UncompressFast( unsigned char *in, unsigned char *out, unsigned int insize );
+void LZ_UncompressStreamInit( LZ_Stream *stream, unsigned char *in,
+  unsigned int insize, unsigned char *window );
+int LZ_UncompressStream( LZ_Stream *stream, unsigned char *out,
+  unsigned int outsize );
 
 
 #ifdef __cplusplus
@@ -17,6 +17,7 @@
 // along with Pi1541. If not, see <http://www.gnu.org/licenses/>.
 
 #include "m6502.h"
+#include "Snapshot.h"
 
 M6502::OpcodeCycleFunction M6502::opcodeFunctions[256] =
 {
@@ -351,6 +352,66 @@ void M6502::Reset(void)
 	Reset_T0();
 }
 
+bool M6502::SaveState(Snapshot& snapshot) const
+{
+	// Mid instruction the address mode and opcode function pointers would also need to be saved.
+	if (!SYNC())
+		return false;
+
+	u8 flags = CLIMaskingInterrupt | (BranchTakenMaskingInterrupt << 1);
+#ifdef  SUPPORT_IRQ
+	flags |= (IRQPending << 2) | ((u8)IRQ.IsAsserted() << 3);
+#endif //  SUPPORT_IRQ
+#ifdef  SUPPORT_NMI
+	flags |= (NMIPending << 4) | ((u8)NMI.IsAsserted() << 5);
+#endif //  SUPPORT_NMI
+
+	snapshot.Write(pc);
+	snapshot.Write(a);
+	snapshot.Write(x);
+	snapshot.Write(y);
+	snapshot.Write(status);
+	snapshot.Write(sp);
+	snapshot.Write(flags);
+	return true;
+}
+
+void M6502::LoadState(Snapshot& snapshot)
+{
+	u8 flags;
+
+	snapshot.Read(pc);
+	snapshot.Read(a);
+	snapshot.Read(x);
+	snapshot.Read(y);
+	snapshot.Read(status);
+	snapshot.Read(sp);
+	snapshot.Read(flags);
+
+	CLIMaskingInterrupt = flags & 1;
+	BranchTakenMaskingInterrupt = (flags >> 1) & 1;
+#ifdef  SUPPORT_IRQ
+	IRQPending = (flags >> 2) & 1;
+	if (flags & 8)
+		IRQ.Assert();
+	else
+		IRQ.Release();
+#endif //  SUPPORT_IRQ
+#ifdef  SUPPORT_NMI
+	NMIPending = (flags >> 4) & 1;
+	if (flags & 0x20)
+		NMI.Assert();
+	else
+		NMI.Release();
+#endif //  SUPPORT_NMI
+#ifdef  SUPPORT_RDY_HALTING
+	RDYCounter = 0;
+	RDYAsserted = 0;
+	RDYHalted = 0;
+#endif //  SUPPORT_RDY_HALTING
+	addressModeCycleFn = &M6502::InstructionFetch;
+}
+
 #ifdef  SUPPORT_RDY_HALTING
 void M6502::RDY(bool asserted)
 {
@@ -62,6 +62,8 @@
 #define M6502_H
 #include "types.h"
 
+class Snapshot;
+
 // Turn SUPPORT_RDY_HALTING on if you would like to support the RDY line and halting the CPU. (eg BA from the VIC-II in a C64)
 //#define SUPPORT_RDY_HALTING
 
@@ -99,7 +101,7 @@ class Interrupt
 {
 public:
 	Interrupt() : asserted(false) { }
-	inline bool IsAsserted() { return asserted; }
+	inline bool IsAsserted() const { return asserted; }
 	inline void Assert()	{ asserted = true; }
 	inline void Release() { asserted = false; }
 	inline void Reset() { Release(); }
@@ -527,6 +529,10 @@ public:
 	// Emulate the 6502's SYNC signal and pin
 	bool SYNC(void) const { return addressModeCycleFn == &M6502::InstructionFetch; }
 
+	// Only valid on an instruction boundary (ie when SYNC() is true). Returns false if not.
+	bool SaveState(Snapshot& snapshot) const;
+	void LoadState(Snapshot& snapshot);
+
 #ifdef  SUPPORT_IRQ
 	Interrupt IRQ;
 #endif //  SUPPORT_IRQ
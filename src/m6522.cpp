@@ -29,6 +29,10 @@ m6522::m6522()
 
 void m6522::Reset()
 {
+#if defined(VIA_LAZY_TIMERS)
+	quietCycles = 0;
+	pendingCycles = 0;
+#endif
 	functionControlRegister = 0;
 	auxiliaryControlRegister = 0;
 
@@ -107,11 +111,17 @@ void m6522::InputCA2(bool value)
 		if (ca2 != value && ((functionControlRegister & FCR_CA2_EDGE_TRIGGER_MODE) != 0) == value)
 			SetInterrupt(IR_CA2);	// interrupt if we are tracking edges
 		ca2 = value;
+#if defined(VIA_LAZY_TIMERS)
+		quietCycles = 0;	// A left over pulse mode will drop ca2 again next cycle
+#endif
 	}
 }
 
 void m6522::InputCB1(bool value)
 {
+#if defined(VIA_LAZY_TIMERS)
+	CatchUp();	// Skipped cycles saw the old cb1
+#endif
 	if (cb1 != value && ((functionControlRegister & FCR_CB1) != 0) == value) // CB1 is an input?
 	{
 		unsigned char ddr = portB.GetDirection();
@@ -132,11 +142,85 @@ void m6522::InputCB2(bool value)
 		if (cb2 != value && ((functionControlRegister & FCR_CB2_EDGE_TRIGGER_MODE) != 0) == value)
 			SetInterrupt(IR_CB2);	// interrupt if we are tracking edges
 		cb2 = value;
+#if defined(VIA_LAZY_TIMERS)
+		quietCycles = 0;	// A left over pulse mode will drop cb2 again next cycle
+#endif
 	}
 }
 
+#if defined(VIA_LAZY_TIMERS)
+// Returns how many of the following cycles can do nothing but count the timers down.
+// Any cycle that could time out, pulse CA2/CB2, shift or raise an IRQ is executed in full.
+unsigned m6522::QuietCyclesAhead()
+{
+	unsigned quiet = 0xffffffff;
+
+	if ((ca2 && pulseCA2) || (cb2 && pulseCB2))
+		return 0;
+
+	if (t1TimedOut || t1Reload || t2TimedOut || t2Reload || cb1OutputShiftClockPositiveEdge)
+		return 0;
+
+	if (t2CountingPB6Mode != t2CountingPB6ModeOld)
+		return 0;
+
+	switch ((auxiliaryControlRegister & ACR_SHIFTREG_CTRL) >> 2)
+	{
+		case 0:		// shift reg disabled
+		case 4:		// free run by timer 2 (only ever clocked in modes 1 and 5)
+		break;
+		case 2:		// shift by phi2
+		case 6:
+			if (!(bitsShiftedSoFar & 8))
+				return 0;
+		break;
+		default:	// shift by timer 2 or an external clock
+			return 0;
+	}
+
+	// T1 times out on the cycle it decrements from 0
+	if (t1Ticking && t1c.value < quiet)
+		quiet = t1c.value;
+
+	// T2 times out on the cycle it decrements to 0
+	if (t2CountingDown)
+	{
+		if (t2CountingPB6Mode)
+			return 0;
+		unsigned t2Quiet = t2c.value ? t2c.value - 1 : 0xffff;
+		if (t2Quiet < quiet)
+			quiet = t2Quiet;
+	}
+	return quiet;
+}
+
+// Apply the skipped quiet cycles to the counters.
+void m6522::CatchUpPending()
+{
+	unsigned cycles = pendingCycles;
+	pendingCycles = 0;
+
+	if (t1Ticking)
+		t1c.value -= cycles;
+
+	if (t2CountingDown)
+	{
+		// Count the times the low order counter passed 0xfe
+		unsigned first = (unsigned char)(t2c.bytes.l - 0xfe);
+		if (first == 0)
+			first = 256;
+		if (cycles >= first)
+			t2TimedOutCount += 1 + ((cycles - first) >> 8);
+		t2c.value -= cycles;
+	}
+
+	pb6Old = portB.GetInput() & ~portB.GetDirection() & 0x40;
+	cb1Old = cb1;
+}
+#endif
+
 // Update for a single cycle
-void m6522::Execute()
+void m6522::ExecuteCycle()
 {
 	if (ca2 && pulseCA2) ca2 = false;
 	if (cb2 && pulseCB2) cb2 = false;
@@ -409,6 +493,10 @@ unsigned char m6522::Read(unsigned int address)
 {
 	unsigned char value = 0;
 
+#if defined(VIA_LAZY_TIMERS)
+	CatchUp();
+#endif
+
 	switch (address & 0xf)
 	{
 		case ORB:
@@ -459,6 +547,9 @@ unsigned char m6522::Read(unsigned int address)
 			value = shiftRegister;
 			if (interruptFlagRegister & IR_SR) bitsShiftedSoFar = 0;
 			ClearInterrupt(IR_SR);
+#if defined(VIA_LAZY_TIMERS)
+			quietCycles = 0;	// May restart a phi2 shift
+#endif
 		break;
 		case ACR:
 			value = auxiliaryControlRegister;
@@ -483,6 +574,10 @@ unsigned char m6522::Peek(unsigned int address)
 {
 	unsigned char value = 0;
 
+#if defined(VIA_LAZY_TIMERS)
+	CatchUp();
+#endif
+
 	switch (address & 0xf)
 	{
 		case ORB:
@@ -541,6 +636,10 @@ void m6522::Write(unsigned int address, unsigned char value)
 {
 	unsigned char ddr;
 
+#if defined(VIA_LAZY_TIMERS)
+	CatchUp();
+#endif
+
 	switch (address & 0xf)
 	{
 		case ORB:
@@ -712,4 +811,123 @@ void m6522::Write(unsigned int address, unsigned char value)
 			WritePortA(value, false);
 		break;
 	}
+
+#if defined(VIA_LAZY_TIMERS)
+	// Anything other than the ports can change what the next cycles do.
+	address &= 0xf;
+	if (address > DDRA && address != ORA_NH)
+		quietCycles = 0;
+#endif
+}
+
+void m6522::SaveState(Snapshot& snapshot)
+{
+#if defined(VIA_LAZY_TIMERS)
+	CatchUp();
+#endif
+	portA.SaveState(snapshot);
+	portB.SaveState(snapshot);
+	snapshot.Write(functionControlRegister);
+	snapshot.Write(auxiliaryControlRegister);
+	snapshot.Write(latchPortA);
+	snapshot.Write(latchedValueA);
+	snapshot.Write(ca1);
+	snapshot.Write(ca2);
+	snapshot.Write(pulseCA2);
+	snapshot.Write(latchPortB);
+	snapshot.Write(latchedValueB);
+	snapshot.Write(cb1);
+	snapshot.Write(cb1Old);
+	snapshot.Write(cb2);
+	snapshot.Write(pulseCB2);
+	snapshot.Write(t1c.value);
+	snapshot.Write(t1l.value);
+	snapshot.Write(t1Ticking);
+	snapshot.Write(t1Reload);
+	snapshot.Write(t1OutPB7);
+	snapshot.Write(t1FreeRun);
+	snapshot.Write(t1FreeRunIRQsOn);
+	snapshot.Write(t1TimedOut);
+	snapshot.Write(t1_pb7);
+	snapshot.Write(t1OneShotTriggeredIRQ);
+	snapshot.Write(t2c.value);
+	snapshot.Write(t2Latch);
+	snapshot.Write(t2Reload);
+	snapshot.Write(t2CountingDown);
+	snapshot.Write(t2CountingPB6ModeOld);
+	snapshot.Write(t2CountingPB6Mode);
+	snapshot.Write(t2TimedOut);
+	snapshot.Write(t2LowTimedOut);
+	snapshot.Write(t2OneShotTriggeredIRQ);
+	snapshot.Write(t2TimedOutCount);
+	snapshot.Write(pb6Old);
+	snapshot.Write(interruptFlagRegister);
+	snapshot.Write(interruptEnabledRegister);
+	snapshot.Write(shiftRegister);
+	snapshot.Write(bitsShiftedSoFar);
+	snapshot.Write(cb1OutputShiftClock);
+	snapshot.Write(cb2Shift);
+	snapshot.Write(cb1OutputShiftClockPositiveEdge);
+}
+
+void m6522::LoadState(Snapshot& snapshot)
+{
+#if defined(VIA_LAZY_TIMERS)
+	quietCycles = 0;
+	pendingCycles = 0;
+#endif
+	portA.LoadState(snapshot);
+	portB.LoadState(snapshot);
+	snapshot.Read(functionControlRegister);
+	snapshot.Read(auxiliaryControlRegister);
+	snapshot.Read(latchPortA);
+	snapshot.Read(latchedValueA);
+	snapshot.Read(ca1);
+	snapshot.Read(ca2);
+	snapshot.Read(pulseCA2);
+	snapshot.Read(latchPortB);
+	snapshot.Read(latchedValueB);
+	snapshot.Read(cb1);
+	snapshot.Read(cb1Old);
+	snapshot.Read(cb2);
+	snapshot.Read(pulseCB2);
+	snapshot.Read(t1c.value);
+	snapshot.Read(t1l.value);
+	snapshot.Read(t1Ticking);
+	snapshot.Read(t1Reload);
+	snapshot.Read(t1OutPB7);
+	snapshot.Read(t1FreeRun);
+	snapshot.Read(t1FreeRunIRQsOn);
+	snapshot.Read(t1TimedOut);
+	snapshot.Read(t1_pb7);
+	snapshot.Read(t1OneShotTriggeredIRQ);
+	snapshot.Read(t2c.value);
+	snapshot.Read(t2Latch);
+	snapshot.Read(t2Reload);
+	snapshot.Read(t2CountingDown);
+	snapshot.Read(t2CountingPB6ModeOld);
+	snapshot.Read(t2CountingPB6Mode);
+	snapshot.Read(t2TimedOut);
+	snapshot.Read(t2LowTimedOut);
+	snapshot.Read(t2OneShotTriggeredIRQ);
+	snapshot.Read(t2TimedOutCount);
+	snapshot.Read(pb6Old);
+	snapshot.Read(interruptFlagRegister);
+	snapshot.Read(interruptEnabledRegister);
+	snapshot.Read(shiftRegister);
+	snapshot.Read(bitsShiftedSoFar);
+	snapshot.Read(cb1OutputShiftClock);
+	snapshot.Read(cb2Shift);
+	snapshot.Read(cb1OutputShiftClockPositiveEdge);
+
+	if (irq)
+	{
+		if (interruptFlagRegister & IR_IRQ)
+			irq->Assert();
+		else
+			irq->Release();
+	}
+	// Let whatever is connected to the ports see the restored outputs.
+	portA.SetOutput(portA.GetOutput());
+	portB.SetOutput(portB.GetOutput());
 }
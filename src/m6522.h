@@ -19,6 +19,7 @@
 #ifndef M6522_H
 #define M6522_H
 
+#include "defs.h"
 #include "IOPort.h"
 #include "m6502.h"
 
@@ -217,17 +218,48 @@ FCR/PCR
 	inline bool GetCB2() { return cb2; }
 	void InputCB2(bool value);
 
-	void Execute();
+	// Update for a single cycle
+	inline void Execute()
+	{
+#if defined(VIA_LAZY_TIMERS)
+		if (quietCycles)
+		{
+			// Only the timer counters change this cycle. They are brought up to date when next needed.
+			quietCycles--;
+			pendingCycles++;
+			return;
+		}
+		CatchUp();
+		ExecuteCycle();
+		quietCycles = QuietCyclesAhead();
+#else
+		ExecuteCycle();
+#endif
+	}
 
 	unsigned char Read(unsigned int address);
 	unsigned char Peek(unsigned int address);
 	void Write(unsigned int address, unsigned char value);
 
+	void SaveState(Snapshot& snapshot);
+	void LoadState(Snapshot& snapshot);
+
 	inline unsigned char GetFCR()
 	{
 		return functionControlRegister;
 	}
 private:
+	void ExecuteCycle();
+#if defined(VIA_LAZY_TIMERS)
+	unsigned QuietCyclesAhead();
+	void CatchUpPending();
+	inline void CatchUp()
+	{
+		if (pendingCycles)
+			CatchUpPending();
+	}
+#endif
+
 	inline unsigned char ReadPortB()
 	{
 		unsigned char ddr = portB.GetDirection();
@@ -380,6 +412,11 @@ private:
 	unsigned cb1OutputShiftClock;
 	unsigned char cb2Shift;  // version of cb2 controlled by the shift register
 	bool cb1OutputShiftClockPositiveEdge;
+
+#if defined(VIA_LAZY_TIMERS)
+	unsigned quietCycles;	// Upcoming cycles in which nothing but the timer counters can change
+	unsigned pendingCycles;	// Quiet cycles skipped but not yet applied to the counters
+#endif
 };
 
 #endif
\ No newline at end of file
@@ -97,6 +97,10 @@ void m8520::Reset()
 	portB.SetDirection(0);
 
 	PCAsserted = 0;
+#if defined(CIA_LAZY_TIMERS)
+	quietCycles = 0;
+	pendingCycles = 0;
+#endif
 
 	FLAGPin = true;	// external devices should be setting this
 	CNTPin = false;	// external devices should be setting this
@@ -150,8 +154,46 @@ void m8520::Reset()
 
 extern u16 pc;
 
+#if defined(CIA_LAZY_TIMERS)
+// Returns how many of the following cycles can do nothing but count the phi2 timers down.
+// Any cycle that could time out, count a CNT edge or drive PC is executed in full.
+// CNT only changes on a timer A time out (output mode) or from outside (input mode, where CNT is not counted)
+// so CNT and timer A underflow counting never happen in a quiet cycle.
+unsigned m8520::QuietCyclesAhead()
+{
+	unsigned quiet = 0xffffffff;
+
+	if (PCAsserted || timerAReloaded || timerBReloaded || CNTPin != CNTPinOld)
+		return 0;
+
+	// A phi2 timer times out on the cycle it decrements from 0
+	if (timerAActive && timerAMode == TA_MODE_PHI2)
+		quiet = timerACounter;
+
+	if (timerBActive && timerBMode == TB_MODE_PHI2 && timerBCounter < quiet)
+		quiet = timerBCounter;
+
+	return quiet;
+}
+
+// Apply the skipped quiet cycles to the counters.
+void m8520::CatchUpPending()
+{
+	unsigned cycles = pendingCycles;
+	pendingCycles = 0;
+
+	if (timerAActive && timerAMode == TA_MODE_PHI2)
+		timerACounter -= cycles;
+
+	if (timerBActive && timerBMode == TB_MODE_PHI2)
+		timerBCounter -= cycles;
+
+	CNTPinOld = CNTPin;
+}
+#endif
+
 // Update for a single cycle
-void m8520::Execute()
+void m8520::ExecuteCycle()
 {
 	bool timerATimedOut = false;
 	bool timerBTimedOut = false;
@@ -356,6 +398,14 @@ void m8520::SetPinFLAG(bool value)	// Active low
 
 void m8520::SetPinCNT(bool value)
 {
+#if defined(CIA_LAZY_TIMERS)
+	// Pi1581::Update() passes CNT on every cycle; only a change needs the skipped cycles (which saw the old CNT) applied.
+	if (CNTPin != value)
+	{
+		CatchUp();
+		quietCycles = 0;
+	}
+#endif
 	if (serialPortMode == SP_MODE_INPUT)
 	{
 		if (!CNTPin && value)	// rising edge?
@@ -410,6 +460,10 @@ unsigned char m8520::Read(unsigned int address)
 {
 	unsigned char value = 0;
 
+#if defined(CIA_LAZY_TIMERS)
+	CatchUp();
+#endif
+
 	switch (address & 0xf)
 	{
 		case ORA:
@@ -421,6 +475,9 @@ unsigned char m8520::Read(unsigned int address)
 			// PC will go low forone cycle following a read orwrite of PORT B.
 			// PC will go low on the 3rd cycle after a PORT B access.
 			PCAsserted = 3;
+#if defined(CIA_LAZY_TIMERS)
+			quietCycles = 0;
+#endif
 		break;
 		case DDRA:
 			value = portA.GetDirection();
@@ -491,6 +548,10 @@ unsigned char m8520::Peek(unsigned int address)
 {
 	unsigned char value = 0;
 
+#if defined(CIA_LAZY_TIMERS)
+	CatchUp();
+#endif
+
 	switch (address & 0xf)
 	{
 		case ORA:
@@ -550,6 +611,13 @@ void m8520::Write(unsigned int address, unsigned char value)
 {
 	unsigned char ddr;
 
+#if defined(CIA_LAZY_TIMERS)
+	CatchUp();
+	// Anything other than the port A and data direction registers can start, stop, reload or retime the timers or drive PC.
+	if ((address & 0xf) != ORA && (address & 0xf) != DDRA && (address & 0xf) != DDRB)
+		quietCycles = 0;
+#endif
+
 	switch (address & 0xf)
 	{
 		case ORA:
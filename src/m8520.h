@@ -22,6 +22,7 @@
 #include "IOPort.h"
 #include "m6502.h"
 #include "debug.h"
+#include "defs.h"
 
 // PA0 SIDE0
 // PA1 !RDY
@@ -131,7 +132,24 @@ public:
 	inline IOPort* GetPortA() { return &portA; }
 	inline IOPort* GetPortB() { return &portB; }
 
-	void Execute();
+	// Update for a single cycle
+	inline void Execute()
+	{
+#if defined(CIA_LAZY_TIMERS)
+		if (quietCycles)
+		{
+			// Only the phi2 timer counters change this cycle. They are brought up to date when next needed.
+			quietCycles--;
+			pendingCycles++;
+			return;
+		}
+		CatchUp();
+		ExecuteCycle();
+		quietCycles = QuietCyclesAhead();
+#else
+		ExecuteCycle();
+#endif
+	}
 
 	unsigned char Read(unsigned int address);
 	unsigned char Peek(unsigned int address);
@@ -146,6 +164,17 @@ public:
 	void SetPinTOD(bool value);
 
 //private:
+	void ExecuteCycle();
+#if defined(CIA_LAZY_TIMERS)
+	unsigned QuietCyclesAhead();
+	void CatchUpPending();
+	inline void CatchUp()
+	{
+		if (pendingCycles)
+			CatchUpPending();
+	}
+#endif
+
 	inline unsigned char ReadPortB()
 	{
 		unsigned char ddr = portB.GetDirection();
@@ -287,6 +316,11 @@ public:
 	unsigned serialBitsShiftedSoFar;
 	bool serialShiftingEnabled;
 	//unsigned timerATimeOutCount;
+
+#if defined(CIA_LAZY_TIMERS)
+	unsigned quietCycles;	// Upcoming cycles in which nothing but the phi2 timer counters can change
+	unsigned pendingCycles;	// Quiet cycles skipped but not yet applied to the counters
+#endif
 };
 
 #endif
\ No newline at end of file
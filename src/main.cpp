@@ -43,6 +43,14 @@ extern "C"
 #include "FileBrowser.h"
 #include "ScreenLCD.h"
 #include "SpinLock.h"
+#include "CycleScheduler.h"
+#include "SyncStats.h"
+#include "logring.h"
+#include "Profile.h"
+#include "PCHistogram.h"
+#include "Snapshot.h"
+#include "JobSystem.h"
+#include "BootTimeline.h"
 
 #include "logo.h"
 #include "sample.h"
@@ -100,6 +108,8 @@ u8 LcdLogoFile[LCD_LOGO_MAX_SIZE];
 u8 s_u8Memory[0xc000];
 
 int numberOfUSBMassStorageDevices = 0;
+// USB drives are only registered at boot; FatFs mounts each one on its first access (eg once it is switched to and browsed).
+static FATFS fileSystemUSB[16];
 DiskCaddy diskCaddy;
 Pi1541 pi1541;
 #if defined(PI1581SUPPORT)
@@ -109,6 +119,7 @@ CEMMCDevice	m_EMMC;
 Screen screen;
 ScreenLCD* screenLCD = 0;
 Options options;
+TimingProfiles timingProfiles;
 const char* fileBrowserSelectedName;
 u8 deviceID = 8;
 IEC_Commands m_IEC_Commands;
@@ -136,6 +147,59 @@ const char* termainalTextNormal = "\E[0m";
 int headSoundFreq;
 int headSoundCounterDuration;
 
+// Emulation loop work run from the cycle scheduler
+enum EmulationEvent
+{
+	EMULATION_EVENT_STATUS,		// Activity LED and starting the head step sound (signalled by the drive when either changes)
+	EMULATION_EVENT_SOUND_GPIO,	// Next edge of the head step sound on the GPIO
+	EMULATION_EVENT_INPUT		// Exit and disk swap requests from the input poller
+};
+// The input requests are checked every 100us (also the rate the buttons are polled on the emulation core if no worker is polling them)
+#define EMULATION_INPUT_CYCLES 100
+CycleScheduler emulationScheduler;
+
+// How well the current emulation session is keeping to the 1MHz clock
+SyncStats syncStats;
+
+#if defined(PC_HISTOGRAM)
+// Where the emulated 6502 spends its time in the current emulation session
+PCHistogram pcHistogram;
+#endif
+
+#if defined(PROFILE)
+perf_section_t profileSections[PROFILE_SECTIONS];
+// How often core 0 prints the profile summary while emulating (in us)
+#define PROFILE_SUMMARY_PERIOD 5000000
+
+void ProfileReset()
+{
+	static const char* names[PROFILE_SECTIONS] = { "CPU", "drive", "VIAs", "bus I/O", "input" };
+	perf_counters_t pct;
+
+#if defined(RPI2) || defined(RPI3)
+	pct.num_counters = 4;
+	pct.type[0] = PERF_TYPE_INST_RETIRED;
+	pct.type[1] = PERF_TYPE_L1I_CACHE_REFILL;
+	pct.type[2] = PERF_TYPE_L1D_CACHE_REFILL;
+	pct.type[3] = PERF_TYPE_L2D_CACHE_REFILL;
+#else
+	pct.num_counters = 2;
+	pct.type[0] = PERF_TYPE_INSTRUCTION_EXECUTED;
+	pct.type[1] = PERF_TYPE_D_CACHE_MISS;
+#endif
+	start_section_counters(&pct);
+
+	for (int section = 0; section < PROFILE_SECTIONS; ++section)
+		clear_perf_section(&profileSections[section], names[section]);
+}
+
+void ProfileDump(const char* name)
+{
+	printf("%s profile:\r\n", name);
+	print_perf_sections(profileSections, PROFILE_SECTIONS);
+}
+#endif
+
 // Hooks required for USPi library
 extern "C"
 {
@@ -280,9 +344,11 @@ void InitialiseHardware()
 #endif
 }
 
+// This is a boot job that can run on another core so it has its own text buffer.
 void InitialiseLCD()
 {
 	FILINFO filLcdIcon;
+	char versionText[32];
 
 	int i2cBusMaster = options.I2CBusMaster();
 	int i2cLcdAddress = options.I2CLcdAddress();
@@ -308,8 +374,8 @@ void InitialiseLCD()
 		if ( (height == 64) && (strcasecmp(options.GetLcdLogoName(), "1541ii") == 0) )
 		{
 			screenLCD->PlotRawImage(logo_ssd_1541ii, 0, 0, width, height);
-			snprintf(tempBuffer, tempBufferSize, "Pi1541 V%d.%02d", versionMajor, versionMinor);
-			screenLCD->PrintText(false, 16, 0, tempBuffer, 0xffffffff);
+			snprintf(versionText, sizeof(versionText), "Pi1541 V%d.%02d", versionMajor, versionMinor);
+			screenLCD->PrintText(false, 16, 0, versionText, 0xffffffff);
 			logo_done = true;
 		}
 		else if (( height == 64) && (strcasecmp(options.GetLcdLogoName(), "1541classic") == 0) )
@@ -335,10 +401,10 @@ void InitialiseLCD()
 
 		if (!logo_done)
 		{
-			snprintf(tempBuffer, tempBufferSize, "Pi1541 V%d.%02d", versionMajor, versionMinor);
-			int x = (width - 8*strlen(tempBuffer) ) /2;
+			snprintf(versionText, sizeof(versionText), "Pi1541 V%d.%02d", versionMajor, versionMinor);
+			int x = (width - 8*strlen(versionText) ) /2;
 			int y = (height-16)/2;
-			screenLCD->PrintText(false, x, y, tempBuffer, 0x0);
+			screenLCD->PrintText(false, x, y, versionText, 0x0);
 		}
 		screenLCD->RefreshScreen();
 	}
@@ -359,7 +425,7 @@ void InitialiseLCD()
 //		printf("\E[1ALED %s%d\E[0m Motor %d Track %0d.%d ATN %d DAT %d CLK %d %s\r\n", LED ? termainalTextRed : termainalTextNormal, LED, Motor, Track >> 1, Track & 1 ? 5 : 0, ATN, DATA, CLOCK, roms.ROMNames[romIndex]);
 //}
 
-void UpdateLCD(const char* track, unsigned temperature)
+void UpdateLCD(const char* track, unsigned temperature, unsigned lostCycles)
 {
 	if (screenLCD)
 	{
@@ -373,6 +439,12 @@ void UpdateLCD(const char* track, unsigned temperature)
 			snprintf(tempBuffer, tempBufferSize, "%s %02dC", track, temperature);
 		else
 			snprintf(tempBuffer, tempBufferSize, "%s", track);
+		if (lostCycles)
+		{
+			// Only shown once the emulation has fallen behind
+			int length = strlen(tempBuffer);
+			snprintf(tempBuffer + length, tempBufferSize - length, " L%u", lostCycles);
+		}
 
 		screenLCD->PrintText(false, 0, 0, tempBuffer, 0, RGBA(0xff, 0xff, 0xff, 0xff));
 		screenLCD->RefreshRows(0, 1);
@@ -401,6 +473,7 @@ void UpdateScreen()
 	u32 textColour = COLOUR_BLACK;
 	u32 bgColour = COLOUR_WHITE;
 	u32 oldTemperature = 0;
+	u32 oldLostCycles = 0;
 	u32 caddyIndexChangedTimer = 0;
 
 	RGBA atnColour = COLOUR_YELLOW;
@@ -427,6 +500,10 @@ void UpdateScreen()
 	top2 = top - (bottom - top);
 	top3 = top2 - (bottom - top);
 
+#if defined(PROFILE)
+	u32 profileSummaryTime = read32(ARM_SYSTIMER_CLO);
+#endif
+
 	while (1)
 	{
 		bool value;
@@ -620,11 +697,28 @@ void UpdateScreen()
 				}
 			}
 
+			u32 lostCycles = syncStats.GetLostCycles();
+			if (lostCycles != oldLostCycles)
+			{
+				oldLostCycles = lostCycles;
+				snprintf(tempBuffer, tempBufferSize, "%-8u", lostCycles);
+				screen.PrintText(false, 53 * 8, y, tempBuffer, lostCycles ? COLOUR_RED : textColour, bgColour);
+				refreshLCDStatusDisplay = true;
+			}
+
+#if defined(PROFILE)
+			if (read32(ARM_SYSTIMER_CLO) - profileSummaryTime >= PROFILE_SUMMARY_PERIOD)
+			{
+				profileSummaryTime = read32(ARM_SYSTIMER_CLO);
+				ProfileDump(emulating == EMULATING_1541 ? "1541" : "1581");
+			}
+#endif
+
 			if (caddyIndexChangedTimer == 0)
 			{
 				if (refreshLCDStatusDisplay)
 				{
-					UpdateLCD(tempBufferTrack, temperature);
+					UpdateLCD(tempBufferTrack, temperature, lostCycles);
 				}
 			}
 			else
@@ -637,6 +731,12 @@ void UpdateScreen()
 		//if (options.GetSupportUARTInput())
 		//	UpdateUartControls(refreshUartStatusDisplay, oldLED, oldMotor, oldATN, oldDATA, oldCLOCK, oldTrack, romIndex);
 
+		// Present whatever has been drawn (by either core) since the last flip.
+		screen.Composite();
+
+		// Print what the emulation core has logged (this core can afford to wait on the UART).
+		log_ring_drain(LOG_RING_RECORDS);
+
 		// Go back to sleep. The USB irq will wake us up again.
 		__asm ("WFE");
 	}
@@ -670,10 +770,9 @@ static bool Snoop(u8 a)
 // This is an implementation of FNV-1a
 // (http://www.isthe.com/chongo/tech/comp/fnv/)
 //--------------------------------------------------------------------------------------
-u32 HashBuffer(const void* pBuffer, u32 length)
+u32 HashBuffer(const void* pBuffer, u32 length, u32 hash)
 {
 	u8*	pu8Buffer = (u8*)pBuffer;
-	u32	hash = 0x811c9dc5U;
 
 	while (length)
 	{
@@ -777,79 +876,227 @@ void CheckAutoMountImage(EXIT_TYPE reset_reason , FileBrowser* fileBrowser)
 	}
 }
 
-EXIT_TYPE Emulate1541(FileBrowser* fileBrowser)
+#if defined(BOOT_SNAPSHOTS)
+// The state of the 1541 after its self test, one for each ROM. They are also saved to the SD card.
+// What the self test leaves behind depends on the ROM, the device ID and the RAM options so these are checked before one is used.
+// A snapshot is only taken if ATN stayed released and the motor stayed off for the whole self test.
+// Otherwise the computer or the disk may have changed what the drive did, so the self test is run again next time.
+#define BOOT_SNAPSHOT_FOLDER "SD:/snapshots"
+#define BOOT_SNAPSHOT_MAGIC 0x50414e53	// "SNAP"
+#define BOOT_SNAPSHOT_MAX_SIZE (0xa000 + 1024)	// RAM (with the RAM board) plus the chips
+
+struct BootSnapshotHeader
 {
-	EXIT_TYPE exitReason = EXIT_UNKNOWN;
-	bool oldLED = false;
-	unsigned ctBefore = 0;
-	unsigned ctAfter = 0;
-	int cycleCount = 0;
-	unsigned caddyIndex;
-	int headSoundCounter = 0;
-	int headSoundFreqCounter = 0;
-	unsigned char oldHeadDir = 0;
-	int resetCount = 0;
-	bool refreshOutsAfterCPUStep = true;
-	unsigned numberOfImages = diskCaddy.GetNumberOfImages();
-	unsigned numberOfImagesMax = numberOfImages;
-	if (numberOfImagesMax > 10)
-		numberOfImagesMax = 10;
+	u32 magic;
+	u32 version;
+	u32 build;		// The single and multi core builds emulate the disk head differently
+	u32 romHash;
+	u32 deviceID;
+	u32 ramSize;
+	u32 size;
+};
 
-#if not defined(EXPERIMENTALZERO)
-	core0RefreshingScreen.Acquire();
-#endif
-	diskCaddy.Display();
-#if not defined(EXPERIMENTALZERO)
-	core0RefreshingScreen.Release();
+struct BootSnapshot
+{
+	BootSnapshotHeader header;
+	u8 data[BOOT_SNAPSHOT_MAX_SIZE];
+	bool valid;
+	bool checkedSD;
+};
+
+static BootSnapshot bootSnapshots[ROMs::MAX_ROMS];
+
+static u32 BootSnapshotRAMSize()
+{
+	if (options.GetRAMBOard())
+		return 0xa000;
+	if (options.GetExtraRAM())
+		return 0x8000;
+	return 0x800;
+}
+
+static void BootSnapshotKey(BootSnapshotHeader& header)
+{
+	const unsigned char* rom = roms.ROMImages[roms.currentROMIndex];
+	u32 hash = 0x811c9dc5;	// FNV-1a
+
+	for (int index = 0; index < ROMs::ROM_SIZE; ++index)
+		hash = (hash ^ rom[index]) * 0x01000193;
+
+	header.magic = BOOT_SNAPSHOT_MAGIC;
+	header.version = SNAPSHOT_VERSION;
+#if defined(EXPERIMENTALZERO)
+	header.build = 1;
+#else
+	header.build = 0;
 #endif
+	header.romHash = hash;
+	header.deviceID = deviceID;
+	header.ramSize = BootSnapshotRAMSize();
+}
 
-	inputMappings->directDiskSwapRequest = 0;
-	// Force an update on all the buttons now before we start emulation mode. 
-	IEC_Bus::ReadBrowseMode();
+static bool BootSnapshotMatches(const BootSnapshotHeader& header, const BootSnapshotHeader& key)
+{
+	return header.magic == key.magic && header.version == key.version && header.build == key.build && header.romHash == key.romHash
+		&& header.deviceID == key.deviceID && header.ramSize == key.ramSize && header.size <= BOOT_SNAPSHOT_MAX_SIZE;
+}
 
-	bool extraRAM = options.GetExtraRAM();
-	DataBusReadFn dataBusRead = extraRAM ? read6502ExtraRAM : read6502;
-	DataBusWriteFn dataBusWrite = extraRAM ? write6502ExtraRAM : write6502;
-	pi1541.m6502.SetBusFunctions(dataBusRead, dataBusWrite);
+static void BootSnapshotFileName(char* fileName, int fileNameSize, u32 romHash)
+{
+	snprintf(fileName, fileNameSize, BOOT_SNAPSHOT_FOLDER "/%08x.snp", (unsigned)romHash);
+}
 
-	IEC_Bus::VIA = &pi1541.VIA[0];
-	IEC_Bus::port = pi1541.VIA[0].GetPortB();
-	pi1541.Reset();	// will call IEC_Bus::Reset();
+static void LoadBootSnapshotFromSD(BootSnapshot& bootSnapshot, const BootSnapshotHeader& key)
+{
+	char fileName[64];
+	FIL fp;
+	u32 bytesRead;
 
-	IEC_Bus::LetSRQBePulledHigh();
+	BootSnapshotFileName(fileName, sizeof(fileName), key.romHash);
+	if (f_open(&fp, fileName, FA_READ) == FR_OK)
+	{
+		if (f_read(&fp, &bootSnapshot.header, sizeof(BootSnapshotHeader), &bytesRead) == FR_OK && bytesRead == sizeof(BootSnapshotHeader)
+			&& BootSnapshotMatches(bootSnapshot.header, key)
+			&& f_read(&fp, bootSnapshot.data, bootSnapshot.header.size, &bytesRead) == FR_OK && bytesRead == bootSnapshot.header.size)
+		{
+			bootSnapshot.valid = true;
+		}
+		f_close(&fp);
+	}
+}
 
-	//resetWhileEmulating = false;
-	selectedViaIECCommands = false;
+static void SaveBootSnapshotToSD(const BootSnapshot& bootSnapshot)
+{
+	char fileName[64];
+	FIL fp;
+	u32 bytesWritten;
 
-	u32 hash = pi1541.drive.GetDiskImage()->GetHash();
-	// 0x42c02586 = maniac_mansion_s1[lucasfilm_1989](ntsc).g64
-	// 0x18651422 = aliens[electric_dreams_1987].g64
-	// 0x2a7f4b77 = zak_mckracken_boot[activision_1988](manual)(!).g64
-	// 0x97732c3e = maniac_mansion_s1[activision_1987](!).g64
-	// 0x63f809d2 = 4x4_offroad_racing_s1[epyx_1988](ntsc)(!).g64
-	if (hash == 0x42c02586 || hash == 0x18651422 || hash == 0x2a7f4b77 || hash == 0x97732c3e || hash == 0x63f809d2)
+	f_mkdir(BOOT_SNAPSHOT_FOLDER);
+	BootSnapshotFileName(fileName, sizeof(fileName), bootSnapshot.header.romHash);
+	if (f_open(&fp, fileName, FA_CREATE_ALWAYS | FA_WRITE) == FR_OK)
 	{
-		refreshOutsAfterCPUStep = false;
+		if (f_write(&fp, &bootSnapshot.header, sizeof(BootSnapshotHeader), &bytesWritten) != FR_OK
+			|| f_write(&fp, bootSnapshot.data, bootSnapshot.header.size, &bytesWritten) != FR_OK || bytesWritten != bootSnapshot.header.size)
+			DEBUG_LOG("Failed to save %s\r\n", fileName);
+		f_close(&fp);
 	}
+}
 
-	// Quickly get through 1541's self test code.
-	// This will make the emulated 1541 responsive to commands asap.
-	// During this time we don't need to set outputs.
+// Returns true if the 1541 has been put into its post self test state.
+static bool RestoreBootSnapshot()
+{
+	BootSnapshot& bootSnapshot = bootSnapshots[roms.currentROMIndex];
+	BootSnapshotHeader key;
 
-	while (cycleCount < FAST_BOOT_CYCLES)
+	// The snapshot was taken with ATN released
+	IEC_Bus::ReadEmulationMode1541();
+	if (IEC_Bus::IsAtnAsserted())
+		return false;
+
+	BootSnapshotKey(key);
+	if (bootSnapshot.valid && !BootSnapshotMatches(bootSnapshot.header, key))
+		bootSnapshot.valid = false;
+	if (!bootSnapshot.valid && !bootSnapshot.checkedSD)
 	{
-		IEC_Bus::ReadEmulationMode1541();
+		bootSnapshot.checkedSD = true;
+		LoadBootSnapshotFromSD(bootSnapshot, key);
+	}
+	if (!bootSnapshot.valid)
+		return false;
 
-		pi1541.m6502.SYNC();
+	Snapshot snapshot(bootSnapshot.data, bootSnapshot.header.size);
+	pi1541.LoadState(snapshot, key.ramSize);
+	return !snapshot.Overflowed();
+}
 
-		pi1541.m6502.Step();
+static void CaptureBootSnapshot()
+{
+	BootSnapshot& bootSnapshot = bootSnapshots[roms.currentROMIndex];
 
-		pi1541.Update();
+	BootSnapshotKey(bootSnapshot.header);
 
-		cycleCount++;
+	Snapshot snapshot(bootSnapshot.data, BOOT_SNAPSHOT_MAX_SIZE);
+	bootSnapshot.valid = pi1541.SaveState(snapshot, bootSnapshot.header.ramSize) && !snapshot.Overflowed();
+	bootSnapshot.checkedSD = true;
+	if (bootSnapshot.valid)
+	{
+		bootSnapshot.header.size = snapshot.Size();
+		SaveBootSnapshotToSD(bootSnapshot);
 	}
+}
+#endif
 
-	// Self test code done. Begin realtime emulation.
+#if defined(BACKGROUND_JOBS)
+// While emulating, a worker polls the buttons and keyboard so that the emulation loop only has to take what it publishes.
+// Between polls the worker sleeps in WFE and the generic timer's event stream wakes it (about every 100us, often enough for the rotary encoder).
+struct InputPoller
+{
+	Job job;
+	unsigned numberOfImages;
+	unsigned numberOfImagesMax;
+	volatile u32 stop;
+};
+static InputPoller inputPoller;
+
+static void InputPollerJob(void* param)
+{
+	InputPoller* poller = (InputPoller*)param;
+	u32 timerControl;
+
+	// Event on every 0 to 1 transition of bit 10 of the (19.2MHz) counter
+	asm volatile ("mrc p15,0,%0,c14,c1,0" : "=r" (timerControl));
+	asm volatile ("mcr p15,0,%0,c14,c1,0" :: "r" ((timerControl & ~0xfc) | (10 << 4) | (1 << 2)));
+
+	u32 before = read32(ARM_SYSTIMER_CLO);
+	while (!poller->stop)
+	{
+		asm volatile ("wfe");
+		u32 now = read32(ARM_SYSTIMER_CLO);
+		inputMappings->PollEmulationMode(poller->numberOfImages, poller->numberOfImagesMax, now - before);
+		before = now;
+	}
+
+	asm volatile ("mcr p15,0,%0,c14,c1,0" :: "r" (timerControl));
+}
+#endif
+
+// Returns false if there is no worker to poll the input (then the emulation loop has to do it).
+static bool StartInputPoller(unsigned numberOfImages, unsigned numberOfImagesMax)
+{
+#if defined(BACKGROUND_JOBS)
+	inputPoller.numberOfImages = numberOfImages;
+	inputPoller.numberOfImagesMax = numberOfImagesMax;
+	inputPoller.stop = 0;
+	inputPoller.job = Job(InputPollerJob, &inputPoller);
+	return JobSystem::TrySubmit(&inputPoller.job);
+#else
+	return false;
+#endif
+}
+
+static void StopInputPoller()
+{
+#if defined(BACKGROUND_JOBS)
+	inputPoller.stop = 1;
+	JobSystem::Wait(&inputPoller.job);
+#endif
+}
+
+// The realtime 1541 loop. It is built once for each combination of the options that are fixed while a disk is mounted
+// so that the per cycle work only contains what the current configuration needs.
+template <bool REFRESH_OUTS_AFTER_CPU_STEP, bool MULTIPLE_IMAGES>
+static EXIT_TYPE Emulate1541Realtime(unsigned numberOfImages, unsigned numberOfImagesMax, bool pollInput)
+{
+	EXIT_TYPE exitReason = EXIT_UNKNOWN;
+	bool exitEmulation = false;
+	bool exitDoAutoLoad = false;
+	bool oldLED = false;
+	unsigned ctBefore = 0;
+	unsigned ctAfter = 0;
+	unsigned caddyIndex;
+	int headSoundCounter = 0;
+	unsigned char oldHeadDir = 0;
+	int resetCount = 0;
 
 #if defined(RPI2)
 	asm volatile ("mrc p15,0,%0,c9,c13,0" : "=r" (ctBefore));
@@ -859,12 +1106,17 @@ EXIT_TYPE Emulate1541(FileBrowser* fileBrowser)
 
 	while (exitReason == EXIT_UNKNOWN)
 	{
-		if (refreshOutsAfterCPUStep)
+		PROFILE_BEGIN(PROFILE_BUS);
+		if (REFRESH_OUTS_AFTER_CPU_STEP)
 			IEC_Bus::ReadEmulationMode1541();
+		PROFILE_END(PROFILE_BUS);
 
 		if (pi1541.m6502.SYNC())	// About to start a new instruction.
 		{
 			pc = pi1541.m6502.GetPC();
+#if defined(PC_HISTOGRAM)
+			pcHistogram.Sample(pc);
+#endif
 			// See if the emulated cpu is executing CD:_ (ie back out of emulated image)
 			if (snoopIndex == 0 && (pc == SNOOP_CD_CBM || pc == SNOOP_CD_JIFFY_BOTH || pc == SNOOP_CD_JIFFY_DRIVEONLY)) snoopPC = pc;
 
@@ -878,7 +1130,9 @@ EXIT_TYPE Emulate1541(FileBrowser* fileBrowser)
 			}
 		}
 
+		PROFILE_BEGIN(PROFILE_CPU);
 		pi1541.m6502.Step();	// If the CPU reads or writes to the VIA then clk and data can change
+		PROFILE_END(PROFILE_CPU);
 
 		//To artificialy delay the outputs later into the phi2's cycle (do this on future Pis that will be faster and perhaps too fast)
 		//read32(ARM_SYSTIMER_CLO);	//Each one of these is > 100ns
@@ -886,46 +1140,10 @@ EXIT_TYPE Emulate1541(FileBrowser* fileBrowser)
 		//read32(ARM_SYSTIMER_CLO);
 
 //		IEC_Bus::ReadEmulationMode1541();
-		if (refreshOutsAfterCPUStep)
+		PROFILE_BEGIN(PROFILE_BUS);
+		if (REFRESH_OUTS_AFTER_CPU_STEP)
 			IEC_Bus::RefreshOuts1541();	// Now output all outputs.
-
-		IEC_Bus::OutputLED = pi1541.drive.IsLEDOn();
-#if defined(RPI3)
-		if (IEC_Bus::OutputLED ^ oldLED)
-		{
-			SetACTLed(IEC_Bus::OutputLED);
-			oldLED = IEC_Bus::OutputLED;
-		}
-#endif
-
-		// Do head moving sound
-		unsigned char headDir = pi1541.drive.GetLastHeadDirection();
-		if (headDir != oldHeadDir)	// Need to start a new sound?
-		{
-			oldHeadDir = headDir;
-			if (options.SoundOnGPIO())
-			{
-				headSoundCounter = headSoundCounterDuration;
-				headSoundFreqCounter = headSoundFreq;
-			}
-			else
-			{
-#if not defined(EXPERIMENTALZERO)
-				PlaySoundDMA();
-#endif
-			}
-		}
-
-		IEC_Bus::ReadGPIOUserInput();
-
-		// Other core will check the uart (as it is slow) (could enable uart irqs - will they execute on this core?)
-#if not defined(EXPERIMENTALZERO)
-		inputMappings->CheckKeyboardEmulationMode(numberOfImages, numberOfImagesMax);
-#endif
-		inputMappings->CheckButtonsEmulationMode();
-
-		bool exitEmulation = inputMappings->Exit();
-		bool exitDoAutoLoad = inputMappings->AutoLoad();
+		PROFILE_END(PROFILE_BUS);
 
 		// We have now output so HERE is where the next phi2 cycle starts.
 		pi1541.Update();
@@ -947,11 +1165,15 @@ EXIT_TYPE Emulate1541(FileBrowser* fileBrowser)
 				exitReason = EXIT_AUTOLOAD;
 		}
 
+		unsigned syncPolls = 0;
 #if defined(RPI2)
 		do  // Sync to the 1MHz clock
 		{
 			asm volatile ("mrc p15,0,%0,c9,c13,0" : "=r" (ctAfter));
+			syncPolls++;
 		} while ((ctAfter - ctBefore) < clockCycles1MHz);
+		if (syncPolls == 1 && (ctAfter - ctBefore) > clockCycles1MHz)
+			syncStats.Overrun(ctAfter - ctBefore - clockCycles1MHz, (ctAfter - ctBefore) / clockCycles1MHz - 1);
 #else
 		do	// Sync to the 1MHz clock
 		{
@@ -962,66 +1184,252 @@ EXIT_TYPE Emulate1541(FileBrowser* fileBrowser)
 				// If this ever occurs then we have taken too long (ie >1us) and lost a cycle.
 				// Cycle accuracy is now in jeopardy. If this occurs during critical communication loops then emulation can fail!
 				//DEBUG_LOG("!");
+				syncStats.Overrun(ct - 1, ct - 1);
 			}
+			syncPolls++;
 		} while (ctAfter == ctBefore);
 #endif
+		syncStats.Cycle(syncPolls - 1);
 		ctBefore = ctAfter;
 		
-		if (!refreshOutsAfterCPUStep)
+		if (!REFRESH_OUTS_AFTER_CPU_STEP)
 		{
+			PROFILE_BEGIN(PROFILE_BUS);
 			IEC_Bus::ReadEmulationMode1541();
 			IEC_Bus::RefreshOuts1541();	// Now output all outputs.
+			PROFILE_END(PROFILE_BUS);
 		}
 
-		if (options.SoundOnGPIO() && headSoundCounter > 0)
+		if (emulationScheduler.Tick())
 		{
-			headSoundFreqCounter--;		// Continue updating a GPIO non DMA sound.
-			if (headSoundFreqCounter <= 0)
+			int event;
+			while ((event = emulationScheduler.NextDue()) != CycleScheduler::NO_EVENT)
 			{
-				headSoundFreqCounter = headSoundFreq;
-				headSoundCounter -= headSoundFreq * 8;
-				IEC_Bus::OutputSound = !IEC_Bus::OutputSound;
-			}
-		}
-
-		if (numberOfImages > 1)
-		{
-			bool nextDisk = inputMappings->NextDisk();
-			bool prevDisk = inputMappings->PrevDisk();
-			if (nextDisk)
-			{
-				pi1541.drive.Insert(diskCaddy.PrevDisk());
-#if defined(EXPERIMENTALZERO)
-				diskCaddy.Update();
-#endif
-			}
-			else if (prevDisk)
-			{
-				pi1541.drive.Insert(diskCaddy.NextDisk());
-#if defined(EXPERIMENTALZERO)
-				diskCaddy.Update();
+				switch (event)
+				{
+					case EMULATION_EVENT_STATUS:
+					{
+						IEC_Bus::OutputLED = pi1541.drive.IsLEDOn();
+#if defined(RPI3)
+						if (IEC_Bus::OutputLED ^ oldLED)
+						{
+							SetACTLed(IEC_Bus::OutputLED);
+							oldLED = IEC_Bus::OutputLED;
+						}
 #endif
-			}
+
+						// Do head moving sound
+						unsigned char headDir = pi1541.drive.GetLastHeadDirection();
+						if (headDir != oldHeadDir)	// Need to start a new sound?
+						{
+							oldHeadDir = headDir;
+							if (options.SoundOnGPIO())
+							{
+								headSoundCounter = headSoundCounterDuration;
+								emulationScheduler.Schedule(EMULATION_EVENT_SOUND_GPIO, headSoundFreq > 0 ? headSoundFreq : 1);
+							}
+							else
+							{
 #if not defined(EXPERIMENTALZERO)
-			else if (inputMappings->directDiskSwapRequest != 0)
-			{
-				for (caddyIndex = 0; caddyIndex < numberOfImagesMax; ++caddyIndex)
-				{
-					if (inputMappings->directDiskSwapRequest & (1 << caddyIndex))
+								PlaySoundDMA();
+#endif
+							}
+						}
+					}
+					break;
+					case EMULATION_EVENT_SOUND_GPIO:
+						// Continue updating a GPIO non DMA sound.
+						headSoundCounter -= headSoundFreq * 8;
+						IEC_Bus::OutputSound = !IEC_Bus::OutputSound;
+						if (headSoundCounter > 0)
+							emulationScheduler.Schedule(EMULATION_EVENT_SOUND_GPIO, headSoundFreq > 0 ? headSoundFreq : 1);
+					break;
+					case EMULATION_EVENT_INPUT:
 					{
-						DiskImage* diskImage = diskCaddy.SelectImage(caddyIndex);
-						if (diskImage && diskImage != pi1541.drive.GetDiskImage())
+						PROFILE_BEGIN(PROFILE_INPUT);
+						if (pollInput)
+							inputMappings->PollEmulationMode(numberOfImages, numberOfImagesMax, EMULATION_INPUT_CYCLES);
+						u32 requests = inputMappings->TakeEmulationRequests();
+						if (requests & ESC_FLAG)
+							exitEmulation = true;
+						if (requests & AUTOLOAD_FLAG)
+							exitDoAutoLoad = true;
+						if (MULTIPLE_IMAGES)
 						{
-							pi1541.drive.Insert(diskImage);
-							break;
+							if (requests & NEXT_FLAG)
+							{
+								DiskImage* diskImage = diskCaddy.PrevDisk();
+								if (diskImage)
+									pi1541.drive.Insert(diskImage);
+							}
+							else if (requests & PREV_FLAG)
+							{
+								DiskImage* diskImage = diskCaddy.NextDisk();
+								if (diskImage)
+									pi1541.drive.Insert(diskImage);
+							}
+#if not defined(EXPERIMENTALZERO)
+							else if (requests >> DIRECT_SWAP_SHIFT)
+							{
+								for (caddyIndex = 0; caddyIndex < numberOfImagesMax; ++caddyIndex)
+								{
+									if (requests & (1 << (DIRECT_SWAP_SHIFT + caddyIndex)))
+									{
+										DiskImage* diskImage = diskCaddy.SelectImage(caddyIndex);
+										if (diskImage && diskImage != pi1541.drive.GetDiskImage())
+										{
+											pi1541.drive.Insert(diskImage);
+											break;
+										}
+									}
+								}
+							}
+#endif
 						}
+#if defined(EXPERIMENTALZERO)
+						diskCaddy.UpdateEmulating();
+#endif
+						PROFILE_END(PROFILE_INPUT);
+						emulationScheduler.Schedule(EMULATION_EVENT_INPUT, EMULATION_INPUT_CYCLES);
 					}
+					break;
 				}
-				inputMappings->directDiskSwapRequest = 0;
 			}
+		}
+	}
+	return exitReason;
+}
+
+EXIT_TYPE Emulate1541(FileBrowser* fileBrowser)
+{
+	EXIT_TYPE exitReason;
+	int cycleCount = 0;
+	bool refreshOutsAfterCPUStep = true;
+	unsigned numberOfImages = diskCaddy.GetNumberOfImages();
+	unsigned numberOfImagesMax = numberOfImages;
+	if (numberOfImagesMax > 10)
+		numberOfImagesMax = 10;
+
+	// The emulation loop can only swap to disks that are already in memory.
+	diskCaddy.PrepareEmulating();
+
+#if not defined(EXPERIMENTALZERO)
+	core0RefreshingScreen.Acquire();
+#endif
+	diskCaddy.Display();
+#if not defined(EXPERIMENTALZERO)
+	core0RefreshingScreen.Release();
 #endif
+
+	inputMappings->ResetEmulationRequests();
+	// Force an update on all the buttons now before we start emulation mode. 
+	IEC_Bus::ReadBrowseMode();
+
+	bool extraRAM = options.GetExtraRAM();
+	DataBusReadFn dataBusRead = extraRAM ? read6502ExtraRAM : read6502;
+	DataBusWriteFn dataBusWrite = extraRAM ? write6502ExtraRAM : write6502;
+	pi1541.m6502.SetBusFunctions(dataBusRead, dataBusWrite);
+
+	IEC_Bus::VIA = &pi1541.VIA[0];
+	IEC_Bus::port = pi1541.VIA[0].GetPortB();
+	pi1541.Reset();	// will call IEC_Bus::Reset();
+
+	IEC_Bus::LetSRQBePulledHigh();
+
+	//resetWhileEmulating = false;
+	selectedViaIECCommands = false;
+
+	// Pick the loop for the timing this title needs (see timing.txt).
+	u32 hash = pi1541.drive.GetDiskImage()->GetHash();
+	refreshOutsAfterCPUStep = timingProfiles.RefreshOutsAfterCPUStep(hash);
+	DEBUG_LOG("Image hash %08x refresh outs after CPU step %d\r\n", hash, refreshOutsAfterCPUStep);
+
+	// Quickly get through 1541's self test code.
+	// This will make the emulated 1541 responsive to commands asap.
+	// During this time we don't need to set outputs.
+#if defined(BOOT_SNAPSHOTS)
+	if (!RestoreBootSnapshot())
+	{
+		bool snapshotValid = true;
+
+		// Finish on an instruction boundary so that the CPU can be snapshot.
+		while (cycleCount < FAST_BOOT_CYCLES || !pi1541.m6502.SYNC())
+		{
+			IEC_Bus::ReadEmulationMode1541();
+
+			pi1541.m6502.Step();
+
+			pi1541.Update();
+
+			if (IEC_Bus::IsAtnAsserted() || pi1541.drive.IsMotorOn())
+				snapshotValid = false;
+
+			cycleCount++;
 		}
+
+		if (snapshotValid)
+			CaptureBootSnapshot();
+	}
+#else
+	while (cycleCount < FAST_BOOT_CYCLES)
+	{
+		IEC_Bus::ReadEmulationMode1541();
+
+		pi1541.m6502.SYNC();
+
+		pi1541.m6502.Step();
+
+		pi1541.Update();
+
+		cycleCount++;
 	}
+#endif
+
+	// Self test code done. Begin realtime emulation.
+
+	emulationScheduler.Reset();
+	pi1541.drive.statusChanged.Connect(&emulationScheduler, EMULATION_EVENT_STATUS);
+	emulationScheduler.Schedule(EMULATION_EVENT_STATUS, 1);
+	emulationScheduler.Schedule(EMULATION_EVENT_INPUT, EMULATION_INPUT_CYCLES);
+	syncStats.Reset();
+#if defined(PROFILE)
+	ProfileReset();
+#endif
+#if defined(PC_HISTOGRAM)
+	pcHistogram.Reset();
+#endif
+
+	bool pollInput = !StartInputPoller(numberOfImages, numberOfImagesMax);
+	if (refreshOutsAfterCPUStep)
+	{
+		if (numberOfImages > 1)
+			exitReason = Emulate1541Realtime<true, true>(numberOfImages, numberOfImagesMax, pollInput);
+		else
+			exitReason = Emulate1541Realtime<true, false>(numberOfImages, numberOfImagesMax, pollInput);
+	}
+	else
+	{
+		if (numberOfImages > 1)
+			exitReason = Emulate1541Realtime<false, true>(numberOfImages, numberOfImagesMax, pollInput);
+		else
+			exitReason = Emulate1541Realtime<false, false>(numberOfImages, numberOfImagesMax, pollInput);
+	}
+	StopInputPoller();
+#if defined(EXPERIMENTALZERO)
+	diskCaddy.FinishEmulating();
+#endif
+
+	syncStats.Dump("1541");
+#if defined(EXPERIMENTALZERO)
+	log_ring_drain(LOG_RING_RECORDS);	// No other core to do it.
+#endif
+#if defined(PROFILE)
+	ProfileDump("1541");
+#endif
+#if defined(PC_HISTOGRAM)
+	pcHistogram.Dump("1541", 0xc000);
+	pcHistogram.Save("SD:/pc1541.bin");
+#endif
 	return exitReason;
 }
 
@@ -1035,15 +1443,19 @@ EXIT_TYPE Emulate1581(FileBrowser* fileBrowser)
 	int cycleCount = 0;
 	unsigned caddyIndex;
 	int headSoundCounter = 0;
-	int headSoundFreqCounter = 0;
 	unsigned int oldTrack = 0;
 	int resetCount = 0;
+	bool exitEmulation = false;
+	bool exitDoAutoLoad = false;
 
 	unsigned numberOfImages = diskCaddy.GetNumberOfImages();
 	unsigned numberOfImagesMax = numberOfImages;
 	if (numberOfImagesMax > 10)
 		numberOfImagesMax = 10;
 
+	// The emulation loop can only swap to disks that are already in memory.
+	diskCaddy.PrepareEmulating();
+
 #if not defined(EXPERIMENTALZERO)
 	core0RefreshingScreen.Acquire();
 #endif
@@ -1052,7 +1464,7 @@ EXIT_TYPE Emulate1581(FileBrowser* fileBrowser)
 	core0RefreshingScreen.Release();
 #endif
 
-	inputMappings->directDiskSwapRequest = 0;
+	inputMappings->ResetEmulationRequests();
 	// Force an update on all the buttons now before we start emulation mode. 
 	IEC_Bus::ReadBrowseMode();
 
@@ -1075,15 +1487,34 @@ EXIT_TYPE Emulate1581(FileBrowser* fileBrowser)
 
 	oldTrack = pi1581.wd177x.GetCurrentTrack();
 
+	emulationScheduler.Reset();
+	pi1581.statusChanged.Connect(&emulationScheduler, EMULATION_EVENT_STATUS);
+	pi1581.wd177x.headMoved.Connect(&emulationScheduler, EMULATION_EVENT_STATUS);
+	emulationScheduler.Schedule(EMULATION_EVENT_STATUS, 1);
+	emulationScheduler.Schedule(EMULATION_EVENT_INPUT, EMULATION_INPUT_CYCLES);
+	syncStats.Reset();
+#if defined(PROFILE)
+	ProfileReset();
+#endif
+#if defined(PC_HISTOGRAM)
+	pcHistogram.Reset();
+#endif
+
+	bool pollInput = !StartInputPoller(numberOfImages, numberOfImagesMax);
 	while (exitReason == EXIT_UNKNOWN)
 	{
+		PROFILE_BEGIN(PROFILE_BUS);
 		IEC_Bus::ReadEmulationMode1581();
+		PROFILE_END(PROFILE_BUS);
 
 		for (int cycle2MHz = 0; cycle2MHz < 2; ++cycle2MHz)
 		{
 			if (pi1581.m6502.SYNC())	// About to start a new instruction.
 			{
 				pc = pi1581.m6502.GetPC();
+#if defined(PC_HISTOGRAM)
+				pcHistogram.Sample(pc);
+#endif
 				// See if the emulated cpu is executing CD:_ (ie back out of emulated image)
 				if (snoopIndex == 0 && (pc == SNOOP_CD_CBM1581)) snoopPC = pc;
 
@@ -1096,49 +1527,15 @@ EXIT_TYPE Emulate1581(FileBrowser* fileBrowser)
 					}
 				}
 			}
+			PROFILE_BEGIN(PROFILE_CPU);
 			pi1581.m6502.Step();
+			PROFILE_END(PROFILE_CPU);
 			pi1581.Update();
 		}
 
+		PROFILE_BEGIN(PROFILE_BUS);
 		IEC_Bus::RefreshOuts1581();	// Now output all outputs.
-
-		IEC_Bus::OutputLED = pi1581.IsLEDOn();
-#if defined(RPI3)
-		if (IEC_Bus::OutputLED ^ oldLED)
-		{
-			SetACTLed(IEC_Bus::OutputLED);
-			oldLED = IEC_Bus::OutputLED;
-		}
-#endif
-
-		// Do head moving sound
-		unsigned int track = pi1581.wd177x.GetCurrentTrack();
-		if (track != oldTrack)	// Need to start a new sound?
-		{
-			oldTrack = track;
-			if (options.SoundOnGPIO())
-			{
-				headSoundCounter = headSoundCounterDuration;
-				headSoundFreqCounter = headSoundFreq;
-			}
-			else
-			{
-#if not defined(EXPERIMENTALZERO)
-				PlaySoundDMA();
-#endif
-			}
-		}
-
-		IEC_Bus::ReadGPIOUserInput();
-
-		// Other core will check the uart (as it is slow) (could enable uart irqs - will they execute on this core?)
-#if not defined(EXPERIMENTALZERO)
-		inputMappings->CheckKeyboardEmulationMode(numberOfImages, numberOfImagesMax);
-#endif
-		inputMappings->CheckButtonsEmulationMode();
-
-		bool exitEmulation = inputMappings->Exit();
-		bool exitDoAutoLoad = inputMappings->AutoLoad();
+		PROFILE_END(PROFILE_BUS);
 
 
 		bool reset = IEC_Bus::IsReset();
@@ -1157,11 +1554,15 @@ EXIT_TYPE Emulate1581(FileBrowser* fileBrowser)
 				exitReason = EXIT_AUTOLOAD;
 		}
 
+		unsigned syncPolls = 0;
 #if defined(RPI2)
 		do  // Sync to the 1MHz clock
 		{
 			asm volatile ("mrc p15,0,%0,c9,c13,0" : "=r" (ctAfter));
+			syncPolls++;
 		} while ((ctAfter - ctBefore) < clockCycles1MHz);
+		if (syncPolls == 1 && (ctAfter - ctBefore) > clockCycles1MHz)
+			syncStats.Overrun(ctAfter - ctBefore - clockCycles1MHz, (ctAfter - ctBefore) / clockCycles1MHz - 1);
 #else
 		do	// Sync to the 1MHz clock
 		{
@@ -1172,61 +1573,126 @@ EXIT_TYPE Emulate1581(FileBrowser* fileBrowser)
 				// If this ever occurs then we have taken too long (ie >1us) and lost a cycle.
 				// Cycle accuracy is now in jeopardy. If this occurs during critical communication loops then emulation can fail!
 				//DEBUG_LOG("!");
+				syncStats.Overrun(ct - 1, ct - 1);
 			}
+			syncPolls++;
 		} while (ctAfter == ctBefore);
 #endif
+		syncStats.Cycle(syncPolls - 1);
 		ctBefore = ctAfter;
 
-		if (options.SoundOnGPIO() && headSoundCounter > 0)
-		{
-			headSoundFreqCounter--;		// Continue updating a GPIO non DMA sound.
-			if (headSoundFreqCounter <= 0)
-			{
-				headSoundFreqCounter = headSoundFreq;
-				headSoundCounter -= headSoundFreq * 8;
-				IEC_Bus::OutputSound = !IEC_Bus::OutputSound;
-			}
-		}
-
-		if (numberOfImages > 1)
+		if (emulationScheduler.Tick())
 		{
-			bool nextDisk = inputMappings->NextDisk();
-			bool prevDisk = inputMappings->PrevDisk();
-			if (nextDisk)
+			int event;
+			while ((event = emulationScheduler.NextDue()) != CycleScheduler::NO_EVENT)
 			{
-				pi1581.Insert(diskCaddy.PrevDisk());
-#if defined(EXPERIMENTALZERO)
-				diskCaddy.Update();
-#endif
-			}
-			else if (prevDisk)
-			{
-				pi1581.Insert(diskCaddy.NextDisk());
-#if defined(EXPERIMENTALZERO)
-				diskCaddy.Update();
+				switch (event)
+				{
+					case EMULATION_EVENT_STATUS:
+					{
+						IEC_Bus::OutputLED = pi1581.IsLEDOn();
+#if defined(RPI3)
+						if (IEC_Bus::OutputLED ^ oldLED)
+						{
+							SetACTLed(IEC_Bus::OutputLED);
+							oldLED = IEC_Bus::OutputLED;
+						}
 #endif
-			}
+
+						// Do head moving sound
+						unsigned int track = pi1581.wd177x.GetCurrentTrack();
+						if (track != oldTrack)	// Need to start a new sound?
+						{
+							oldTrack = track;
+							if (options.SoundOnGPIO())
+							{
+								headSoundCounter = headSoundCounterDuration;
+								emulationScheduler.Schedule(EMULATION_EVENT_SOUND_GPIO, headSoundFreq > 0 ? headSoundFreq : 1);
+							}
+							else
+							{
 #if not defined(EXPERIMENTALZERO)
-			else if (inputMappings->directDiskSwapRequest != 0)
-			{
-				for (caddyIndex = 0; caddyIndex < numberOfImagesMax; ++caddyIndex)
-				{
-					if (inputMappings->directDiskSwapRequest & (1 << caddyIndex))
+								PlaySoundDMA();
+#endif
+							}
+						}
+					}
+					break;
+					case EMULATION_EVENT_SOUND_GPIO:
+						// Continue updating a GPIO non DMA sound.
+						headSoundCounter -= headSoundFreq * 8;
+						IEC_Bus::OutputSound = !IEC_Bus::OutputSound;
+						if (headSoundCounter > 0)
+							emulationScheduler.Schedule(EMULATION_EVENT_SOUND_GPIO, headSoundFreq > 0 ? headSoundFreq : 1);
+					break;
+					case EMULATION_EVENT_INPUT:
 					{
-						DiskImage* diskImage = diskCaddy.SelectImage(caddyIndex);
-						if (diskImage && diskImage != pi1581.GetDiskImage())
+						PROFILE_BEGIN(PROFILE_INPUT);
+						if (pollInput)
+							inputMappings->PollEmulationMode(numberOfImages, numberOfImagesMax, EMULATION_INPUT_CYCLES);
+						u32 requests = inputMappings->TakeEmulationRequests();
+						if (requests & ESC_FLAG)
+							exitEmulation = true;
+						if (requests & AUTOLOAD_FLAG)
+							exitDoAutoLoad = true;
+						if (numberOfImages > 1)
 						{
-							pi1581.Insert(diskImage);
-							break;
+							if (requests & NEXT_FLAG)
+							{
+								DiskImage* diskImage = diskCaddy.PrevDisk();
+								if (diskImage)
+									pi1581.Insert(diskImage);
+							}
+							else if (requests & PREV_FLAG)
+							{
+								DiskImage* diskImage = diskCaddy.NextDisk();
+								if (diskImage)
+									pi1581.Insert(diskImage);
+							}
+#if not defined(EXPERIMENTALZERO)
+							else if (requests >> DIRECT_SWAP_SHIFT)
+							{
+								for (caddyIndex = 0; caddyIndex < numberOfImagesMax; ++caddyIndex)
+								{
+									if (requests & (1 << (DIRECT_SWAP_SHIFT + caddyIndex)))
+									{
+										DiskImage* diskImage = diskCaddy.SelectImage(caddyIndex);
+										if (diskImage && diskImage != pi1581.GetDiskImage())
+										{
+											pi1581.Insert(diskImage);
+											break;
+										}
+									}
+								}
+							}
+#endif
 						}
+#if defined(EXPERIMENTALZERO)
+						diskCaddy.UpdateEmulating();
+#endif
+						PROFILE_END(PROFILE_INPUT);
+						emulationScheduler.Schedule(EMULATION_EVENT_INPUT, EMULATION_INPUT_CYCLES);
 					}
+					break;
 				}
-				inputMappings->directDiskSwapRequest = 0;
 			}
-#endif
 		}
-
 	}
+	StopInputPoller();
+#if defined(EXPERIMENTALZERO)
+	diskCaddy.FinishEmulating();
+#endif
+	syncStats.Dump("1581");
+#if defined(EXPERIMENTALZERO)
+	log_ring_drain(LOG_RING_RECORDS);	// No other core to do it.
+#endif
+#if defined(PROFILE)
+	ProfileDump("1581");
+#endif
+#if defined(PC_HISTOGRAM)
+	pcHistogram.Dump("1581", 0x8000);
+	pcHistogram.Save("SD:/pc1581.bin");
+#endif
 	return exitReason;
 }
 #endif
@@ -1242,6 +1708,7 @@ void emulator()
 	roms.lastManualSelectedROMIndex = 0;
 
 	diskCaddy.SetScreen(&screen, screenLCD, &roms);
+	diskCaddy.SetCompressImages(options.CompressCaddyImages() != 0);
 	fileBrowser = new FileBrowser(inputMappings, &diskCaddy, &roms, &deviceID, options.DisplayPNGIcons(), &screen, screenLCD, options.ScrollHighlightRate());
 	pi1541.Initialise();
 
@@ -1438,12 +1905,39 @@ extern "C"
 		DEBUG_LOG("emulator running on core %d\r\n", _get_core());
 		emulator();
 	}
+
+#if defined(BACKGROUND_JOBS)
+	void run_worker_core()
+	{
+		enable_MMU_and_IDCaches();
+		_enable_unaligned_access();
+
+		JobSystem::WorkerMain();
+	}
+#endif
 }
 static void start_core(int core, func_ptr func)
 {
 	write32(0x4000008C + 0x10 * core, (unsigned int)func);
 	__asm ("SEV");	// and wake it up.
 }
+
+#if defined(BACKGROUND_JOBS)
+// Start the workers one at a time as each rewrites the (shared) page tables as it enables its MMU.
+static void StartWorkerCores()
+{
+	for (int core = JobSystem::FIRST_WORKER_CORE; core < JobSystem::FIRST_WORKER_CORE + JobSystem::NUM_WORKERS; ++core)
+	{
+		start_core(core, _init_worker_core);
+		u32 startTime = read32(ARM_SYSTIMER_CLO);
+		while (!JobSystem::IsWorkerRunning(core) && (read32(ARM_SYSTIMER_CLO) - startTime) < 100000)
+		{
+		}
+		if (!JobSystem::IsWorkerRunning(core))
+			DEBUG_LOG("Background job core %d did not start\r\n", core);
+	}
+}
+#endif
 #endif
 
 static bool AttemptToLoadROM(char* ROMName)
@@ -1515,6 +2009,25 @@ static void LoadOptions()
 	}
 }
 
+static void LoadTimingProfiles()
+{
+	FIL fp;
+	FRESULT res;
+
+	res = f_open(&fp, "timing.txt", FA_READ);
+	if (res == FR_OK)
+	{
+		u32 bytesRead;
+		SetACTLed(true);
+		f_read(&fp, s_u8Memory, sizeof(s_u8Memory) - 1, &bytesRead);
+		SetACTLed(false);
+		f_close(&fp);
+
+		s_u8Memory[bytesRead] = 0;
+		timingProfiles.Process((char*)s_u8Memory);
+	}
+}
+
 void DisplayOptions(int y_pos)
 {
 #if not defined(EXPERIMENTALZERO)
@@ -1570,16 +2083,13 @@ void DisplayI2CScan(int y_pos)
 #endif
 }
 
-static void CheckOptions()
+// Reads the ROMs (and the font ROM) named in the options.
+// This is a boot job that can run on another core while this one initialises USB so it only reads the SD card and leaves the screen alone.
+static void LoadROMs()
 {
 	FIL fp;
 	FRESULT res;
 
-	u32 widthText, heightText;
-	u32 widthScreen = screen.Width();
-	u32 heightScreen = screen.Height();
-	u32 xpos, ypos;
-
 	deviceID = (u8)options.GetDeviceID();
 	DEBUG_LOG("DeviceID = %d\r\n", deviceID);
 #if not defined(EXPERIMENTALZERO)
@@ -1599,13 +2109,6 @@ static void CheckOptions()
 		{
 			u32 bytesRead;
 
-			screen.Clear(COLOUR_BLACK);
-			snprintf(tempBuffer, tempBufferSize, "Loading Font ROM %s\r\n", FontROMName);
-			screen.MeasureText(false, tempBuffer, &widthText, &heightText);
-			xpos = (widthScreen - widthText) >> 1;
-			ypos = (heightScreen - heightText) >> 1;
-			screen.PrintText(false, xpos, ypos, tempBuffer, COLOUR_WHITE, COLOUR_RED);
-
 			SetACTLed(true);
 			res = f_read(&fp, CBMFontData, CBMFont_size, &bytesRead);
 			SetACTLed(false);
@@ -1626,13 +2129,6 @@ static void CheckOptions()
 		{
 			u32 bytesRead;
 
-			screen.Clear(COLOUR_BLACK);
-			snprintf(tempBuffer, tempBufferSize, "Loading ROM %s\r\n", ROMName1581);
-			screen.MeasureText(false, tempBuffer, &widthText, &heightText);
-			xpos = (widthScreen - widthText) >> 1;
-			ypos = (heightScreen - heightText) >> 1;
-			screen.PrintText(false, xpos, ypos, tempBuffer, COLOUR_WHITE, COLOUR_RED);
-
 			SetACTLed(true);
 			res = f_read(&fp, roms.ROMImage1581, ROMs::ROM1581_SIZE, &bytesRead);
 			SetACTLed(false);
@@ -1668,13 +2164,6 @@ static void CheckOptions()
 		{
 			u32 bytesRead;
 
-			screen.Clear(COLOUR_BLACK);
-			snprintf(tempBuffer, tempBufferSize, "Loading ROM %s\r\n", ROMName);
-			screen.MeasureText(false, tempBuffer, &widthText, &heightText);
-			xpos = (widthScreen - widthText) >> 1;
-			ypos = (heightScreen - heightText) >> 1;
-			screen.PrintText(false, xpos, ypos, tempBuffer, COLOUR_WHITE, COLOUR_RED);
-
 			SetACTLed(true);
 			res = f_read(&fp, roms.ROMImages[ROMIndex], ROMs::ROM_SIZE, &bytesRead);
 			SetACTLed(false);
@@ -1690,7 +2179,22 @@ static void CheckOptions()
 	}
 
 
-	if (roms.ROMValid[0] == false && !(AttemptToLoadROM("d1541.rom") || AttemptToLoadROM("dos1541") || AttemptToLoadROM("d1541II") || AttemptToLoadROM("Jiffy.bin")))
+	if (roms.ROMValid[0] == false)
+	{
+		// Fall back to the usual names for a 1541 ROM (AttemptToLoadROM() sets ROMValid[0]).
+		if (!AttemptToLoadROM("d1541.rom") && !AttemptToLoadROM("dos1541") && !AttemptToLoadROM("d1541II"))
+			AttemptToLoadROM("Jiffy.bin");
+	}
+}
+
+static void CheckOptions()
+{
+	u32 widthText, heightText;
+	u32 widthScreen = screen.Width();
+	u32 heightScreen = screen.Height();
+	u32 xpos, ypos;
+
+	if (roms.ROMValid[0] == false)
 	{
 		snprintf(tempBuffer, tempBufferSize, "No ROM file found!\r\nPlease copy a valid 1541 ROM file in the root folder of the SD card.\r\nThe file needs to be called 'dos1541'.");
 		screen.MeasureText(false, tempBuffer, &widthText, &heightText);
@@ -1713,6 +2217,35 @@ static void CheckOptions()
 	inputMappings->INPUT_BUTTON_INSERT = options.GetButtonInsert();
 }
 
+enum BootStep
+{
+	BOOT_STEP_SD,
+	BOOT_STEP_OPTIONS,
+	BOOT_STEP_HARDWARE,
+	BOOT_STEP_WORKERS,
+	BOOT_STEP_LOGO,
+	BOOT_STEP_LCD,
+	BOOT_STEP_ROMS,
+	BOOT_STEP_USB,
+	BOOT_STEP_USB_DRIVES
+};
+
+static BootTimeline bootTimeline;
+
+static void InitialiseLCDJob(void*)
+{
+	bootTimeline.Begin(BOOT_STEP_LCD, "LCD");
+	InitialiseLCD();
+	bootTimeline.End(BOOT_STEP_LCD);
+}
+
+static void LoadROMsJob(void*)
+{
+	bootTimeline.Begin(BOOT_STEP_ROMS, "ROMs");
+	LoadROMs();
+	bootTimeline.End(BOOT_STEP_ROMS);
+}
+
 void Reboot_Pi()
 {
 	if (screenLCD)
@@ -1720,6 +2253,11 @@ void Reboot_Pi()
 	reboot_now();
 }
 
+bool IsUSBDriveMounted(int USBDriveIndex)
+{
+	return fileSystemUSB[USBDriveIndex].fs_type != 0;
+}
+
 bool SwitchDrive(const char* drive)
 {
 	FRESULT res;
@@ -1870,8 +2408,8 @@ extern "C"
 	{
 		FRESULT res;
 		FATFS fileSystemSD;
-		FATFS fileSystemUSB[16];
 
+		bootTimeline.Begin(BOOT_STEP_SD, "SD card");
 		m_EMMC.Initialize();
 
 #if not defined(EXPERIMENTALZERO)
@@ -1880,18 +2418,39 @@ extern "C"
 
 		disk_setEMM(&m_EMMC);
 		f_mount(&fileSystemSD, "SD:", 1);
+		bootTimeline.End(BOOT_STEP_SD);
 
+		bootTimeline.Begin(BOOT_STEP_OPTIONS, "options");
 		LoadOptions();
+		LoadTimingProfiles();
+		bootTimeline.End(BOOT_STEP_OPTIONS);
 
+		bootTimeline.Begin(BOOT_STEP_HARDWARE, "hardware");
 		InitialiseHardware();
 		enable_MMU_and_IDCaches();
 		_enable_unaligned_access();
 
 		write32(ARM_GPIO_GPCLR0, 0xFFFFFFFF);
+		bootTimeline.End(BOOT_STEP_HARDWARE);
 
-		DisplayLogo();
+#if defined(BACKGROUND_JOBS)
+		bootTimeline.Begin(BOOT_STEP_WORKERS, "job cores");
+		StartWorkerCores();
+		bootTimeline.End(BOOT_STEP_WORKERS);
+#endif
 
-		InitialiseLCD();
+		// The rest of the boot overlaps the steps that do not depend on each other;-
+		//	LCD then ROMs	- one after the other on a job core (both can read the SD card and FatFs is not reentrant)
+		//	logo then USB	- on this core (USB needs this core's interrupts)
+		//	USB drives		- once the ROMs are loaded (FatFs again)
+		// Without the job cores the jobs are just run now, in the same order.
+		Job lcdJob(InitialiseLCDJob, 0);
+		Job romsJob(LoadROMsJob, 0);
+		JobSystem::Submit(&lcdJob, JobSystem::FIRST_WORKER_CORE);
+		JobSystem::Submit(&romsJob, JobSystem::FIRST_WORKER_CORE);
+
+		bootTimeline.Begin(BOOT_STEP_LOGO, "logo");
+		DisplayLogo();
 #if not defined(EXPERIMENTALZERO)
 		int y_pos = 184;
 		snprintf(tempBuffer, tempBufferSize, "Copyright(C) 2018 Stephen White");
@@ -1902,12 +2461,17 @@ extern "C"
 		screen.PrintText(false, 0, y_pos+=16, tempBuffer, COLOUR_WHITE, COLOUR_BLACK);
 
 		if (options.I2CScan())
+		{
+			JobSystem::Wait(&lcdJob);	// Shares the I2C bus with the LCD
 			DisplayI2CScan(y_pos+=32);
+		}
 
 		if (options.ShowOptions())
 			DisplayOptions(y_pos+=32);
 
 #endif
+		bootTimeline.End(BOOT_STEP_LOGO);
+
 		headSoundFreq = 1000000 / options.SoundOnGPIOFreq();	// 1200Hz = 1/1200 * 10^6;
 		headSoundCounterDuration = 1000 * options.SoundOnGPIODuration();
 
@@ -1918,6 +2482,7 @@ extern "C"
 #if not defined(EXPERIMENTALZERO)
 		TimerSystemInitialize();
 
+		bootTimeline.Begin(BOOT_STEP_USB, "USB");
 		USPiInitialize();
 
 		DEBUG_LOG("\r\n");
@@ -1937,10 +2502,13 @@ extern "C"
 		//	DEBUG_LOG("Mouse found\r\n");
 
 		keyboard = new Keyboard();
+		bootTimeline.End(BOOT_STEP_USB);
 #endif
 		inputMappings = new InputMappings();
 		//USPiMouseRegisterStatusHandler(MouseHandler);
 
+		JobSystem::Wait(&lcdJob);
+		JobSystem::Wait(&romsJob);
 
 		CheckOptions();
 
@@ -1964,18 +2532,21 @@ extern "C"
 			//PlaySoundDMA();
 		}
 
+		bootTimeline.Begin(BOOT_STEP_USB_DRIVES, "USB drives");
 		for (int USBDriveIndex = 0; USBDriveIndex < numberOfUSBMassStorageDevices; ++USBDriveIndex)
 		{
 			char USBDriveId[16];
 			disk_setUSB(USBDriveIndex);
 			sprintf(USBDriveId, "USB%02d:", USBDriveIndex + 1);
-			res = f_mount(&fileSystemUSB[USBDriveIndex], USBDriveId, 1);
+			res = f_mount(&fileSystemUSB[USBDriveIndex], USBDriveId, 0);
 		}
 		if (numberOfUSBMassStorageDevices > 0)
 		{
+			// (this mounts USB01)
 			if (SwitchDrive("USB01:"))
 				UpdateFirmwareToSD();
 		}
+		bootTimeline.End(BOOT_STEP_USB_DRIVES);
 #endif
 		f_chdir("/1541");
 
@@ -1986,13 +2557,19 @@ extern "C"
 		pi1541.drive.SetVIA(&pi1541.VIA[1]);
 		pi1541.VIA[0].GetPortB()->SetPortOut(0, IEC_Bus::PortB_OnPortOut);
 		IEC_Bus::Initialise();
+		bootTimeline.Dump();
+
 		if (screenLCD)
 			screenLCD->ClearInit(0);
 
 #ifdef HAS_MULTICORE
+#if !defined(BACKGROUND_JOBS)
 		start_core(3, _spin_core);
 		start_core(2, _spin_core);
+#endif
 #ifdef USE_MULTICORE
+		// From now on the screen is only presented by core0 (in UpdateScreen).
+		screen.EnableCompositor();
 		start_core(1, _init_core);
 		UpdateScreen();		// core0 now loops here where it will handle interrupts and passively update the screen.
 		while (1);
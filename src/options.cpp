@@ -139,6 +139,7 @@ Options::Options(void)
 	, invertIECOutputs(1)
 	, splitIECLines(0)
 	, ignoreReset(0)
+	, compressCaddyImages(0)
 	, autoBootFB128(0)
 	, displayTemperature(0)
 	, lowercaseBrowseModeFilenames(0)
@@ -230,6 +231,7 @@ void Options::Process(char* buffer)
 		ELSE_CHECK_DECIMAL_OPTION(invertIECOutputs)
 		ELSE_CHECK_DECIMAL_OPTION(splitIECLines)
 		ELSE_CHECK_DECIMAL_OPTION(ignoreReset)
+		ELSE_CHECK_DECIMAL_OPTION(compressCaddyImages)
 		ELSE_CHECK_DECIMAL_OPTION(lowercaseBrowseModeFilenames)
 		ELSE_CHECK_DECIMAL_OPTION(autoBootFB128)
 		ELSE_CHECK_DECIMAL_OPTION(displayTemperature)
@@ -382,3 +384,59 @@ DiskImage::DiskType Options::GetNewDiskType() const
 	return DiskImage::D64;
 }
 
+TimingProfiles::TimingProfiles(void)
+	: TextParser()
+	, numberOfProfiles(0)
+{
+	Add(0x42c02586, false);	// maniac_mansion_s1[lucasfilm_1989](ntsc).g64
+	Add(0x18651422, false);	// aliens[electric_dreams_1987].g64
+	Add(0x2a7f4b77, false);	// zak_mckracken_boot[activision_1988](manual)(!).g64
+	Add(0x97732c3e, false);	// maniac_mansion_s1[activision_1987](!).g64
+	Add(0x63f809d2, false);	// 4x4_offroad_racing_s1[epyx_1988](ntsc)(!).g64
+}
+
+void TimingProfiles::Add(u32 hash, bool refreshOutsAfterCPUStep)
+{
+	u32 index;
+
+	// A title already in the table (eg one of the built in ones) gets the new profile.
+	for (index = 0; index < numberOfProfiles; ++index)
+	{
+		if (profiles[index].hash == hash)
+			break;
+	}
+	if (index == MAX_PROFILES)
+		return;
+	if (index == numberOfProfiles)
+		numberOfProfiles++;
+	profiles[index].hash = hash;
+	profiles[index].refreshOutsAfterCPUStep = refreshOutsAfterCPUStep;
+}
+
+void TimingProfiles::Process(char* buffer)
+{
+	SetData(buffer);
+
+	char* pHash;
+	while ((pHash = GetToken()) != 0)
+	{
+		/*char* equals = */GetToken();
+		char* pValue = GetToken();
+
+		if (pValue == 0)
+			break;
+
+		Add(strtoul(pHash, NULL, 0), Options::GetDecimal(pValue) != 0);
+	}
+}
+
+bool TimingProfiles::RefreshOutsAfterCPUStep(u32 hash) const
+{
+	for (u32 index = 0; index < numberOfProfiles; ++index)
+	{
+		if (profiles[index].hash == hash)
+			return profiles[index].refreshOutsAfterCPUStep;
+	}
+	return true;
+}
+
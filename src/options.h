@@ -71,6 +71,7 @@ public:
 	inline unsigned int InvertIECInputs() const { return invertIECInputs; }
 	inline unsigned int InvertIECOutputs() const { return invertIECOutputs; }
 	inline unsigned int IgnoreReset() const { return ignoreReset; }
+	inline unsigned int CompressCaddyImages() const { return compressCaddyImages; }
 
 	inline unsigned int AutoBootFB128() const { return autoBootFB128; }
 	inline const char* Get128BootSectorName() const { return C128BootSectorName; }
@@ -138,6 +139,7 @@ private:
 	unsigned int invertIECOutputs;
 	unsigned int splitIECLines;
 	unsigned int ignoreReset;
+	unsigned int compressCaddyImages;
 	unsigned int autoBootFB128;
 
 	unsigned int displayTemperature;
@@ -193,4 +195,33 @@ private:
 	unsigned int rotaryEncoderInvert;
 
 };
+
+// The emulation timing each title needs, looked up by the hash of its image file (see DiskImage::GetHash()).
+// A few titles are built in and timing.txt on the SD card adds more (or overrides them) with lines of the form
+//	0x42c02586 = 0	// maniac_mansion_s1[lucasfilm_1989](ntsc).g64
+// where the value says whether the 1541's outputs are refreshed straight after each CPU step (1, what other titles get)
+// or only once the emulation has synced to the 1MHz clock (0).
+class TimingProfiles : public TextParser
+{
+public:
+	TimingProfiles(void);
+
+	void Process(char* buffer);
+
+	bool RefreshOutsAfterCPUStep(u32 hash) const;
+
+private:
+	void Add(u32 hash, bool refreshOutsAfterCPUStep);
+
+	struct Profile
+	{
+		u32 hash;
+		bool refreshOutsAfterCPUStep;
+	};
+
+	static const u32 MAX_PROFILES = 512;
+
+	Profile profiles[MAX_PROFILES];
+	u32 numberOfProfiles;
+};
 #endif
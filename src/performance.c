@@ -228,6 +228,68 @@ void print_performance_counters(perf_counters_t *pct) {
 		printf("%26s = %u\r\n", type_lookup(pct->type[i]), pct->counter[i]);
 	}
 }
+
+perf_counters_t perf_section_counters;
+
+void start_section_counters(perf_counters_t *pct) {
+	// Same as reset_performance_counters except the cycle counter is left counting every cycle and is not reset
+	unsigned ctrl = 0x03;
+
+	perf_section_counters = *pct;
+
+#if defined(RPI2) || defined(RPI3)
+	int i;
+	unsigned cntenset = (1 << 31);
+
+	unsigned type_impl;
+
+	asm volatile ("mrc p15,0,%0,c9,c12,6" : "=r" (type_impl));
+
+	for (i = 0; i < pct->num_counters; i++) {
+		if ((type_impl >> pct->type[i]) & 1) {
+			asm volatile ("mcr p15,0,%0,c9,c12,5" :: "r" (i) : "memory");
+			asm volatile ("mcr p15,0,%0,c9,c13,1" :: "r" (pct->type[i]) : "memory");
+			cntenset |= (1 << i);
+		}
+		else {
+			printf("Event: %s not implemented\r\n", type_lookup(pct->type[i]));
+		}
+	}
+	asm volatile ("mcr p15,0,%0,c9,c12,0" :: "r" (ctrl) : "memory");
+	asm volatile ("mcr p15,0,%0,c9,c12,1" :: "r" (cntenset) : "memory");
+#else
+	perf_section_counters.num_counters = 2;
+	ctrl |= (pct->type[0] << 20);
+	ctrl |= (pct->type[1] << 12);
+	asm volatile ("mcr p15,0,%0,c15,c12,0" :: "r" (ctrl) : "memory");
+#endif
+}
+
+void clear_perf_section(perf_section_t *section, const char *name) {
+	memset(section, 0, sizeof(perf_section_t));
+	section->name = name;
+}
+
+void print_perf_sections(perf_section_t *sections, int num_sections) {
+	int i, j;
+	unsigned long long total = 0;
+	for (i = 0; i < num_sections; i++)
+		total += sections[i].cycles;
+	if (total == 0)
+		return;
+	printf("%10s %10s %14s %5s", "section", "calls", "cycles", "%");
+	for (j = 0; j < perf_section_counters.num_counters; j++)
+		printf(" %22s", type_lookup(perf_section_counters.type[j]));
+	printf("\r\n");
+	for (i = 0; i < num_sections; i++) {
+		// These are being added to by another core so a count may be slightly out (or torn) but this is only a guide.
+		perf_section_t *section = &sections[i];
+		printf("%10s %10u %14llu %5u", section->name, section->calls, section->cycles, (unsigned)(section->cycles * 100 / total));
+		for (j = 0; j < perf_section_counters.num_counters; j++)
+			printf(" %22llu", section->counter[j]);
+		printf("\r\n");
+	}
+}
 /*
 int benchmark() {
 	int i;
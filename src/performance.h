@@ -102,6 +102,61 @@ extern void read_performance_counters(perf_counters_t *pct);
 
 extern void print_performance_counters(perf_counters_t *pct);
 
+// Section profiling
+// Rather than resetting the counters around one piece of code, the counters are left free running and the
+// counts between perf_section_begin() and perf_section_end() are accumulated into the section.
+// The cycle counter counts every processor cycle (no /64 divider) and is never reset (the RPI2 syncs to it).
+
+typedef struct {
+   const char *name;
+   unsigned calls;
+   unsigned long long cycles;
+   unsigned long long counter[MAX_COUNTERS];
+   unsigned start_cycle;
+   unsigned start[MAX_COUNTERS];
+} perf_section_t;
+
+// The events counted by all sections (set by start_section_counters)
+extern perf_counters_t perf_section_counters;
+
+// Configure the events and start the counters free running. Must be called on the core being profiled.
+extern void start_section_counters(perf_counters_t *pct);
+
+extern void clear_perf_section(perf_section_t *section, const char *name);
+
+extern void print_perf_sections(perf_section_t *sections, int num_sections);
+
+static inline void read_section_counters(unsigned *cycle_counter, unsigned *counter) {
+#if defined(RPI2) || defined(RPI3)
+	int i;
+	for (i = 0; i < perf_section_counters.num_counters; i++) {
+		asm volatile ("mcr p15,0,%0,c9,c12,5" :: "r" (i) : "memory");
+		asm volatile ("mrc p15,0,%0,c9,c13,2" : "=r" (counter[i]));
+	}
+	asm volatile ("mrc p15,0,%0,c9,c13,0" : "=r" (*cycle_counter));
+#else
+	asm volatile ("mrc p15,0,%0,c15,c12,2" : "=r" (counter[0]));
+	asm volatile ("mrc p15,0,%0,c15,c12,3" : "=r" (counter[1]));
+	asm volatile ("mrc p15,0,%0,c15,c12,1" : "=r" (*cycle_counter));
+#endif
+}
+
+static inline void perf_section_begin(perf_section_t *section) {
+	read_section_counters(&section->start_cycle, section->start);
+}
+
+static inline void perf_section_end(perf_section_t *section) {
+	int i;
+	unsigned cycle_counter;
+	unsigned counter[MAX_COUNTERS];
+	read_section_counters(&cycle_counter, counter);
+	// The 32 bit counters may wrap between the two reads so just accumulate the differences.
+	section->cycles += cycle_counter - section->start_cycle;
+	for (i = 0; i < perf_section_counters.num_counters; i++)
+		section->counter[i] += counter[i] - section->start[i];
+	section->calls++;
+}
+
 //extern int benchmark();
 
 #endif
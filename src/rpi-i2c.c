@@ -6,6 +6,7 @@
 #include "stdlib.h"
 
 #include "rpiHardware.h"
+#include "rpi-i2c.h"
 
 /* Define the system clock frequency in MHz for the baud rate calculation.
 This is clearly defined on the BCM2835 datasheet errata page:
@@ -185,6 +186,50 @@ int RPI_I2CWrite(int BSCMaster, unsigned char slaveAddress, void* buffer, unsign
 	return success;
 }
 
+static void I2CWriteFIFO(TI2CWrite* write, unsigned baseAddress, unsigned maxBytes)
+{
+	while (write->count > 0 && maxBytes > 0 && (read32(baseAddress + I2C_BSC_S) & STATUS_BIT_TXD))
+	{
+		write32(baseAddress + I2C_BSC_FIFO, *write->data++);
+		write->count--;
+		maxBytes--;
+	}
+}
+
+void RPI_I2CWriteBegin(TI2CWrite* write, int BSCMaster, unsigned char slaveAddress, const void* buffer, unsigned count, unsigned maxBytes)
+{
+	unsigned baseAddress = GetBaseAddress(BSCMaster);
+
+	write->BSCMaster = BSCMaster;
+	write->data = (const unsigned char*)buffer;
+	write->count = count;
+
+	write32(baseAddress + I2C_BSC_A, slaveAddress);
+	write32(baseAddress + I2C_BSC_C, CONTROL_BIT_CLEAR1);
+	write32(baseAddress + I2C_BSC_S, STATUS_BIT_CLKT | STATUS_BIT_ERR | STATUS_BIT_DONE);
+	write32(baseAddress + I2C_BSC_DLEN, count);
+
+	I2CWriteFIFO(write, baseAddress, maxBytes);
+
+	// The controller holds the bus while the FIFO is empty so the rest can follow in RPI_I2CWriteStep().
+	write32(baseAddress + I2C_BSC_C, CONTROL_BIT_I2CEN | CONTROL_BIT_ST);
+}
+
+int RPI_I2CWriteStep(TI2CWrite* write, unsigned maxBytes)
+{
+	unsigned baseAddress = GetBaseAddress(write->BSCMaster);
+	unsigned status = read32(baseAddress + I2C_BSC_S);
+
+	if (status & (STATUS_BIT_DONE | STATUS_BIT_ERR | STATUS_BIT_CLKT))
+	{
+		write32(baseAddress + I2C_BSC_S, STATUS_BIT_CLKT | STATUS_BIT_ERR | STATUS_BIT_DONE);
+		return 1;
+	}
+
+	I2CWriteFIFO(write, baseAddress, maxBytes);
+	return 0;
+}
+
 int RPI_I2CScan(int BSCMaster, unsigned char slaveAddress)
 {
 	int success = 1;
@@ -9,4 +9,16 @@ extern int RPI_I2CRead(int BSCMaster, unsigned char slaveAddress, void* buffer,
 extern int RPI_I2CWrite(int BSCMaster, unsigned char slaveAddress, void* buffer, unsigned count);
 extern int RPI_I2CScan(int BSCMaster, unsigned char slaveAddress);
 
+// A write that is fed to the FIFO a few bytes at a time so that the caller never waits on the bus.
+typedef struct
+{
+	int BSCMaster;
+	const unsigned char* data;
+	unsigned count;		// Bytes still to go into the FIFO
+} TI2CWrite;
+
+// Both put at most maxBytes into the FIFO. RPI_I2CWriteStep() returns 1 once the transfer has finished.
+extern void RPI_I2CWriteBegin(TI2CWrite* write, int BSCMaster, unsigned char slaveAddress, const void* buffer, unsigned count, unsigned maxBytes);
+extern int RPI_I2CWriteStep(TI2CWrite* write, unsigned maxBytes);
+
 #endif
@@ -42,6 +42,8 @@ extern void _init_core();
 
 extern void _spin_core();
 
+extern void _init_worker_core();
+
 #ifdef HAS_40PINS
 extern void _toggle_test_pin(int count);
 #endif
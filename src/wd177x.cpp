@@ -33,6 +33,7 @@
 
 #include "wd177x.h"
 #include "debug.h"
+#include "logring.h"
 
 #include "Pi1581.h"
 
@@ -58,11 +59,19 @@ static const unsigned int CYCLES_8Mhz_PER_BYTE = 261;
 WD177x::WD177x()
 {
 	diskImage = 0;
+#if defined(WD177X_SCHEDULED_EVENTS)
+	quietCycles = 0;
+	pendingCycles = 0;
+#endif
 	Reset();
 }
 
 void WD177x::Reset()
 {
+#if defined(WD177X_SCHEDULED_EVENTS)
+	CatchUp();
+	quietCycles = 0;
+#endif
 	inactiveRotationCount = 0;
 
 	externalMotorAsserted = false;
@@ -195,6 +204,7 @@ void WD177x::UpdateCommandType1()
 				commandStage++;
 		break;
 		case 4:
+			headMoved.Signal();
 			switch (command)
 			{
 				case RESTORE:
@@ -402,7 +412,7 @@ void WD177x::UpdateCommandType2()
 					{
 						if (writeProtectAsserted)
 						{
-							DEBUG_LOG("WP\r\n");
+							FAST_LOG("WD177x write protected\r\n");
 							statusRegister |= WRITE_PROTECT;
 							CommandComplete();
 						}
@@ -537,7 +547,7 @@ void WD177x::UpdateCommandType2()
 
 									for (int i = 0; i < sbo; ++i)
 									{
-										DEBUG_LOG("%d %02x\r\n", i, sb[i]);
+										FAST_LOG("%d %02x\r\n", i, sb[i]);
 									}
 									sbo = 0;
 								}
@@ -856,8 +866,124 @@ bool WD177x::ReadByte(unsigned char& byte, bool& syncByte)
 //	}
 //}
 
+#if defined(WD177X_SCHEDULED_EVENTS)
+// Returns how many of the following cycles can do nothing but advance the rotation and count a delay down.
+// A cycle that completes a rotation, crosses the index hole (Type I status), ends a delay or settle time, or shifts a byte is executed in full.
+unsigned WD177x::QuietCyclesAhead()
+{
+	if (rotationCycle >= CYCLES_8Mhz_PER_ROTATION)
+		return 0;
+
+	unsigned quiet = CYCLES_8Mhz_PER_ROTATION - 1 - rotationCycle;
+	unsigned event = quiet;
+
+	switch (commandType)
+	{
+		case 0:
+			if (delayTimer > 0)
+				event = delayTimer - 1;
+		break;
+		case 1:
+		{
+			// For Type I commands the index and track zero status bits are refreshed every cycle
+			unsigned char pinStatus = (GetIPPin() ? 0 : INDEX_DATAREQUEST) | (GetTR00Pin() ? TRACKZERO_LOSTDATA : 0);
+			if ((statusRegister & (INDEX_DATAREQUEST | TRACKZERO_LOSTDATA)) != pinStatus)
+				return 0;
+
+			if (rotationCycle < CYCLES_8Mhz_PER_INDEX_HOLE - 1)
+				quiet = CYCLES_8Mhz_PER_INDEX_HOLE - 1 - rotationCycle;
+			else if (rotationCycle < CYCLES_8Mhz_PER_INDEX_HOLE)
+				return 0;
+
+			if ((commandStage != 1 && commandStage != 3) || delayTimer < 0)
+				return 0;
+			event = delayTimer;
+		}
+		break;
+		case 2:
+		case 3:
+			switch (command)
+			{
+				case READ_SECTOR:
+				case WRITE_SECTOR:
+				case READ_ADDRESS:
+				case READ_TRACK:
+				case WRITE_TRACK:
+				break;
+				default:
+					return 0;
+			}
+
+			if (commandStage == 1)
+			{
+				if (delayTimer < 0)
+					return 0;
+				event = delayTimer;
+			}
+			else if (commandStage == 2)
+			{
+				// Only once the first spin up cycle has set the status
+				if (statusRegister != BUSY || lastByteWasASync)
+					return 0;
+				event = settleCycleDelay;
+			}
+			else if (commandStage == 3 && command == READ_TRACK)
+			{
+				// Waiting for the index hole
+			}
+			else if ((commandStage == 3 && command != WRITE_TRACK) || (commandStage == 4 && command == READ_TRACK))
+			{
+				// Waiting for the next byte to be shifted in
+				if (byteRotationCycle + 1 >= CYCLES_8Mhz_PER_BYTE)
+					return 0;
+				event = CYCLES_8Mhz_PER_BYTE - 1 - byteRotationCycle;
+			}
+			else
+			{
+				return 0;
+			}
+		break;
+		default:
+			return 0;
+	}
+
+	if (event < quiet)
+		quiet = event;
+	return quiet;
+}
+
+// Apply the skipped quiet cycles to the counters.
+void WD177x::CatchUpPending()
+{
+	unsigned cycles = pendingCycles;
+	pendingCycles = 0;
+
+	rotationCycle += cycles;
+
+	switch (commandType)
+	{
+		case 0:
+			if (delayTimer)
+				delayTimer -= cycles;
+		break;
+		case 1:
+			delayTimer -= cycles;
+		break;
+		case 2:
+		case 3:
+			if (commandStage == 1)
+				delayTimer -= cycles;
+			else if (commandStage == 2)
+				settleCycleDelay -= cycles;
+			else if (commandStage == 4 || command != READ_TRACK)
+				byteRotationCycle += cycles;
+		break;
+	}
+}
+#endif
+
 // Update for a single cycle
-void WD177x::Execute()
+void WD177x::ExecuteCycle()
 {
 	// The Direction signal is active high when stepping in and low when stepping out.
 	// A 4 uSec(MFM) or 8 uSec(FM) pulse is provided as	an output to the drive.
@@ -959,6 +1085,9 @@ unsigned char WD177x::Read(unsigned int address)
 			value = dataRegister;
 			// When the Data Register is read the DRQ bit in the Status Register and the DRQ line are automatically reset.
 			statusRegister &= ~INDEX_DATAREQUEST;
+#if defined(WD177X_SCHEDULED_EVENTS)
+			quietCycles = 0;	// Type I commands set the index bit again next cycle
+#endif
 		break;
 	}
 
@@ -999,6 +1128,11 @@ void WD177x::Write(unsigned int address, unsigned char value)
 
 	// Alter any register is written to, the same register can not be read from until 16 usec in MFM or 32 usec in FM have elapsed.
 
+#if defined(WD177X_SCHEDULED_EVENTS)
+	CatchUp();
+	quietCycles = 0;
+#endif
+
 	inactiveRotationCount = 0;
 
 	switch (address & 3)
@@ -1019,7 +1153,7 @@ void WD177x::Write(unsigned int address, unsigned char value)
 
 			if ((statusRegister & BUSY) && (command != FORCE_INTERRUPT))
 			{
-				DEBUG_LOG("Command rejected BUSY\n");
+				FAST_LOG("Command rejected BUSY\n");
 			}
 			else
 			{
@@ -1242,7 +1376,7 @@ void WD177x::Write(unsigned int address, unsigned char value)
 					case READ_TRACK:
 						// This command dumps a raw track, including gaps, ID fields, and data, into the Data Register.
 
-						DEBUG_LOG("READ_TRACK\r\n");
+						FAST_LOG("READ_TRACK\r\n");
 
 						commandType = 3;
 					break;
@@ -1260,7 +1394,7 @@ void WD177x::Write(unsigned int address, unsigned char value)
 						// $FE - ID Address Mark (clock pattern C7)
 						// $FB - Data Address Mark (clock pattern C7)
 						// $F8 - Deleted Data Address Mark (clock pattern C7)
-						DEBUG_LOG("WRITE_TRACK\r\n");
+						FAST_LOG("WRITE_TRACK\r\n");
 
 						commandType = 3;
 					break;
@@ -1280,7 +1414,7 @@ void WD177x::Write(unsigned int address, unsigned char value)
 
 						CommandComplete();
 
-						DEBUG_LOG("FORCE_INTERRUPT\r\n");
+						FAST_LOG("FORCE_INTERRUPT\r\n");
 
 
 						// Don't understand this? Shouldn't it be opposite (D8 enables the IRQ and D0 clears it)?
@@ -1347,6 +1481,9 @@ void WD177x::SpinDown()
 
 void WD177x::AssertExternalMotor(bool assert)
 {
+#if defined(WD177X_SCHEDULED_EVENTS)
+	quietCycles = 0;	// Type II and III commands rewrite the status next cycle
+#endif
 	externalMotorAsserted = assert;
 
 	if (externalMotorAsserted)
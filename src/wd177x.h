@@ -22,6 +22,8 @@
 #include "IOPort.h"
 #include "DiskImage.h"
 #include "m6502.h"
+#include "defs.h"
+#include "CycleScheduler.h"
 
 //32x	4e
 // For 10 sectors
@@ -162,7 +164,39 @@ public:
 
 	void Reset();
 
-	void Execute();
+	// Update for a single 8MHz cycle
+	inline void Execute()
+	{
+#if defined(WD177X_SCHEDULED_EVENTS)
+		if (quietCycles)
+		{
+			// Only the rotation and delay counters change this cycle. They are brought up to date when next needed.
+			quietCycles--;
+			pendingCycles++;
+			return;
+		}
+		CatchUp();
+		ExecuteCycle();
+		quietCycles = QuietCyclesAhead();
+#else
+		ExecuteCycle();
+#endif
+	}
+
+	// Update for a number of 8MHz cycles
+	inline void Execute(unsigned cycles)
+	{
+#if defined(WD177X_SCHEDULED_EVENTS)
+		if (quietCycles >= cycles)
+		{
+			quietCycles -= cycles;
+			pendingCycles += cycles;
+			return;
+		}
+#endif
+		while (cycles--)
+			Execute();
+	}
 
 	unsigned char Read(unsigned int address);
 	unsigned char Peek(unsigned int address);
@@ -172,7 +206,11 @@ public:
 	//bool GetSTEPPin() const { return STEPPulse; }
 	inline bool GetTR00Pin() const { return !(currentTrack == 0); }	// active low
 	// IP is the index pulse
+#if defined(WD177X_SCHEDULED_EVENTS)
+	inline bool GetIPPin() const { return !(rotationCycle + pendingCycles < CYCLES_8Mhz_PER_INDEX_HOLE); }	// active low
+#else
 	inline bool GetIPPin() const { return !(rotationCycle < CYCLES_8Mhz_PER_INDEX_HOLE); }	// active low
+#endif
 	//bool GetDRQPin() const { return ; } // This active high output indicates that the Data Register is full(on a Read) or empty(on a Write operation).
 	bool GetWPRTPin() const; // active low
 	void SetWPRTPin(bool value); // active low
@@ -185,6 +223,17 @@ public:
 	inline bool IsExternalMotorAsserted() const { return externalMotorAsserted; }
 
 private:
+	void ExecuteCycle();
+#if defined(WD177X_SCHEDULED_EVENTS)
+	unsigned QuietCyclesAhead();
+	void CatchUpPending();
+	inline void CatchUp()
+	{
+		if (pendingCycles)
+			CatchUpPending();
+	}
+#endif
+
 	bool SpinUp();
 	void SpinDown();
 
@@ -260,6 +309,14 @@ private:
 
 	unsigned short crc;
 	unsigned char dataAddressMark;
+
+#if defined(WD177X_SCHEDULED_EVENTS)
+	unsigned quietCycles;	// Upcoming cycles in which nothing but the rotation and delay counters can change
+	unsigned pendingCycles;	// Quiet cycles skipped but not yet applied to the counters
+#endif
+
+public:
+	CycleSchedulerSignal headMoved;	// A type I command has finished (and may have moved the head)
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,127 @@
+// Times a model of the realtime 1541 loop in main.cpp with refreshOutsAfterCPUStep tested on every cycle, as
+// Emulate1541 used to, against the Emulate1541Realtime instances that fold it away at compile time.
+// The bus, CPU and drive are stand ins that cannot be inlined (as the real ones are in other translation units)
+// and there is no 1MHz sync, so this only shows what the per cycle tests cost.
+//	emulate1541_bench [cycles]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+typedef unsigned int u32;
+
+static volatile u32 gpioLevels;
+static u32 gpioOuts;
+static u32 cpuState = 1;
+static u32 pc;
+static u32 driveCycles;
+static bool sync;
+static bool resetAsserted;
+static u32 snoopPC = ~0u;
+static u32 schedulerCountdown = 1;
+
+__attribute__((noinline)) static void ReadEmulationMode1541() { gpioOuts ^= gpioLevels & 0x3f; }
+__attribute__((noinline)) static void RefreshOuts1541() { gpioLevels = gpioOuts; }
+__attribute__((noinline)) static void Step() { cpuState = cpuState * 1103515245 + 12345; sync = (cpuState >> 16 & 3) == 0; pc = cpuState >> 16; }
+__attribute__((noinline)) static void Update() { driveCycles++; }
+__attribute__((noinline)) static void HandleEvents() { schedulerCountdown = 1000; }
+
+static inline bool Tick()
+{
+	return --schedulerCountdown == 0;
+}
+
+// The per cycle work of Emulate1541Realtime. The option is either a bool, tested every cycle as Emulate1541 used to,
+// or a Constant known at compile time as the template parameter now is.
+template <typename Option>
+static inline u32 Emulate(Option refreshOutsAfterCPUStep, u32 cycles)
+{
+	u32 exits = 0;
+	int resetCount = 0;
+
+	for (u32 cycle = 0; cycle < cycles; ++cycle)
+	{
+		if (refreshOutsAfterCPUStep)
+			ReadEmulationMode1541();
+
+		if (sync && pc == snoopPC)
+			exits++;
+
+		Step();
+
+		if (refreshOutsAfterCPUStep)
+			RefreshOuts1541();
+
+		Update();
+
+		if (resetAsserted)
+			resetCount++;
+		else
+			resetCount = 0;
+		if (resetCount > 10)
+			exits++;
+
+		if (!refreshOutsAfterCPUStep)
+		{
+			ReadEmulationMode1541();
+			RefreshOuts1541();
+		}
+
+		if (Tick())
+			HandleEvents();
+	}
+	return exits;
+}
+
+template <bool VALUE>
+struct Constant
+{
+	operator bool() const { return VALUE; }
+};
+
+// (noclone so that it is not specialised on the constant it is called with here.)
+__attribute__((noinline, noclone)) static u32 EmulateTested(bool refreshOutsAfterCPUStep, u32 cycles)
+{
+	return Emulate(refreshOutsAfterCPUStep, cycles);
+}
+
+template <bool REFRESH_OUTS_AFTER_CPU_STEP>
+__attribute__((noinline)) static u32 EmulateSpecialised(u32 cycles)
+{
+	return Emulate(Constant<REFRESH_OUTS_AFTER_CPU_STEP>(), cycles);
+}
+
+static double Now()
+{
+	timespec time;
+	clock_gettime(CLOCK_MONOTONIC, &time);
+	return time.tv_sec * 1e9 + time.tv_nsec;
+}
+
+int main(int argc, char** argv)
+{
+	u32 cycles = argc > 1 ? strtoul(argv[1], 0, 0) : 100000000;
+	u32 exits = 0;
+
+	for (int refresh = 1; refresh >= 0; --refresh)
+	{
+		double tested = 1e30;
+		double specialised = 1e30;
+
+		// Best of three to keep other activity on the host out of it.
+		for (int repeat = 0; repeat < 3; ++repeat)
+		{
+			double start = Now();
+			exits += EmulateTested(refresh != 0, cycles);
+			double middle = Now();
+			exits += refresh ? EmulateSpecialised<true>(cycles) : EmulateSpecialised<false>(cycles);
+			double end = Now();
+			if (middle - start < tested)
+				tested = middle - start;
+			if (end - middle < specialised)
+				specialised = end - middle;
+		}
+		printf("refreshOutsAfterCPUStep %-5s tested %.3f ns/cycle  specialised %.3f ns/cycle\n", refresh ? "true" : "false", tested / cycles, specialised / cycles);
+	}
+	return exits == ~0u;
+}
@@ -0,0 +1,79 @@
+// Times decompressing an NBZ three ways: LZ_Uncompress (what opening an NBZ used to do),
+// LZ_UncompressFast into one buffer and the track by track LZ_UncompressStream that OpenNBZ now uses.
+//	nbz_open_bench [file.nib]
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <vector>
+#include "lz.h"
+#include "nib_image.h"
+
+static unsigned char window[LZ_WINDOW_SIZE];
+static unsigned char track[NIB_TRACK_LENGTH];
+
+static double Now()
+{
+	timespec time;
+	clock_gettime(CLOCK_MONOTONIC, &time);
+	return time.tv_sec + time.tv_nsec * 1e-9;
+}
+
+int main(int argc, char** argv)
+{
+	std::vector<unsigned char> nib;
+	if (!LoadNIBImage(nib, argc > 1 ? argv[1] : 0))
+	{
+		printf("cannot load %s\n", argv[1]);
+		return 1;
+	}
+
+	std::vector<unsigned char> nbz(nib.size() * 257 / 256 + 1);
+	std::vector<unsigned char> out(nib.size() + 64);
+	unsigned size = nib.size();
+	unsigned nbzSize = LZ_Compress(&nib[0], &nbz[0], size);
+	const int repeats = 50;
+	double start;
+	double whole, fast, stream;
+	bool same = true;
+
+	printf("NIB %u bytes, NBZ %u bytes\n", size, nbzSize);
+
+	start = Now();
+	for (int repeat = 0; repeat < repeats; ++repeat)
+		same &= LZ_Uncompress(&nbz[0], &out[0], nbzSize) == (int)size;
+	whole = (Now() - start) / repeats;
+	same &= memcmp(&out[0], &nib[0], size) == 0;
+
+	start = Now();
+	for (int repeat = 0; repeat < repeats; ++repeat)
+		same &= LZ_UncompressFast(&nbz[0], &out[0], nbzSize) == (int)size;
+	fast = (Now() - start) / repeats;
+	same &= memcmp(&out[0], &nib[0], size) == 0;
+
+	// The stream only ever holds the history window and one track.
+	start = Now();
+	for (int repeat = 0; repeat < repeats; ++repeat)
+	{
+		LZ_Stream lzStream;
+		unsigned offset = 0x100;
+
+		LZ_UncompressStreamInit(&lzStream, &nbz[0], nbzSize, window);
+		same &= LZ_UncompressStream(&lzStream, track, 0x100) == 0x100;
+		while (offset < size && LZ_UncompressStream(&lzStream, track, NIB_TRACK_LENGTH) == NIB_TRACK_LENGTH)
+		{
+			if (repeat == 0)
+				same &= memcmp(track, &nib[offset], NIB_TRACK_LENGTH) == 0;
+			offset += NIB_TRACK_LENGTH;
+		}
+		same &= offset == size && !lzStream.error;
+	}
+	stream = (Now() - start) / repeats;
+
+	printf("LZ_Uncompress        %7.3f ms  %7.1f MB/s\n", whole * 1e3, size / whole / 1e6);
+	printf("LZ_UncompressFast    %7.3f ms  %7.1f MB/s\n", fast * 1e3, size / fast / 1e6);
+	printf("LZ_UncompressStream  %7.3f ms  %7.1f MB/s  (%u bytes held rather than %u)\n", stream * 1e3, size / stream / 1e6, (unsigned)(sizeof(window) + sizeof(track)), size);
+	if (!same)
+		printf("decompressed data does not match\n");
+	return same ? 0 : 1;
+}
@@ -0,0 +1,79 @@
+// Times compressing a NIB for NBZ write-back with LZ_Compress and LZ_CompressFast (what WriteNBZ used to use)
+// and with LZ_CompressHash at a range of efforts, and checks that each stream decompresses back to the image.
+//	nbz_write_bench [file.nib]
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <vector>
+#include "lz.h"
+#include "nib_image.h"
+
+#define NBZ_COMPRESSION_EFFORT 16	// (as in DiskImage.cpp)
+
+static std::vector<unsigned char> nib;
+static std::vector<unsigned char> nbz;
+static std::vector<unsigned char> out;
+
+static double Now()
+{
+	timespec time;
+	clock_gettime(CLOCK_MONOTONIC, &time);
+	return time.tv_sec + time.tv_nsec * 1e-9;
+}
+
+// Compresses until at least half a second has gone by and reports the average.
+static bool Time(const char* name, int compressor, unsigned effort)
+{
+	unsigned size = nib.size();
+	unsigned nbzSize = 0;
+	int repeats = 0;
+	double start = Now();
+	double elapsed;
+
+	do
+	{
+		switch (compressor)
+		{
+			case 0:
+				nbzSize = LZ_Compress(&nib[0], &nbz[0], size);
+			break;
+			case 1:
+				nbzSize = LZ_CompressFast(&nib[0], &nbz[0], size);
+			break;
+			default:
+				nbzSize = LZ_CompressHash(&nib[0], &nbz[0], size, effort);
+			break;
+		}
+		repeats++;
+		elapsed = Now() - start;
+	}
+	while (elapsed < 0.5);
+
+	bool same = LZ_Uncompress(&nbz[0], &out[0], nbzSize) == (int)size && memcmp(&out[0], &nib[0], size) == 0;
+	printf("%-20s %9.3f ms  %7u bytes  %5.1f%%%s\n", name, elapsed * 1e3 / repeats, nbzSize, nbzSize * 100.0 / size, same ? "" : "  does not decompress to the image");
+	return same;
+}
+
+int main(int argc, char** argv)
+{
+	if (!LoadNIBImage(nib, argc > 1 ? argv[1] : 0))
+	{
+		printf("cannot load %s\n", argv[1]);
+		return 1;
+	}
+	nbz.resize(nib.size() * 257 / 256 + 1);
+	out.resize(nib.size() + 64);
+
+	printf("NIB %u bytes (* is the effort WriteNBZ uses)\n", (unsigned)nib.size());
+
+	bool same = Time("LZ_Compress", 0, 0);
+	same &= Time("LZ_CompressFast", 1, 0);
+	for (unsigned effort = 1; effort <= 256; effort *= 4)
+	{
+		char name[32];
+		sprintf(name, "LZ_CompressHash %u%s", effort, effort == NBZ_COMPRESSION_EFFORT ? "*" : "");
+		same &= Time(name, 2, effort);
+	}
+	return same ? 0 : 1;
+}
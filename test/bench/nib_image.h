@@ -0,0 +1,90 @@
+// The NIB the LZ benchmarks compress and decompress: either a real .nib file given on the command line or,
+// without one, a 35 track disk laid out the way nibtools reads it (GCR sectors with syncs and gaps and the
+// start of the track read again to fill the NIB_TRACK_LENGTH block).
+
+#ifndef NIB_IMAGE_H
+#define NIB_IMAGE_H
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+#define NIB_TRACK_LENGTH 0x2000
+
+static const unsigned char nibGCR[16] = { 0x0a, 0x0b, 0x12, 0x13, 0x0e, 0x0f, 0x16, 0x17, 0x09, 0x19, 0x1a, 0x1b, 0x0d, 0x1d, 0x1e, 0x15 };
+
+static void NIBAppendGCR(std::vector<unsigned char>& track, const unsigned char* data, unsigned length)
+{
+	for (unsigned i = 0; i < length; i += 4)
+	{
+		unsigned long long bits = 0;
+		for (unsigned j = 0; j < 4; ++j)
+			bits = (bits << 10) | (nibGCR[data[i + j] >> 4] << 5) | nibGCR[data[i + j] & 0xf];
+		for (int j = 4; j >= 0; --j)
+			track.push_back((unsigned char)(bits >> (j * 8)));
+	}
+}
+
+static void NIBAppend(std::vector<unsigned char>& track, unsigned char value, unsigned count)
+{
+	track.insert(track.end(), count, value);
+}
+
+static bool LoadNIBImage(std::vector<unsigned char>& nib, const char* fileName)
+{
+	if (fileName)
+	{
+		FILE* fp = fopen(fileName, "rb");
+		if (!fp)
+			return false;
+		unsigned char buffer[4096];
+		size_t read;
+		nib.clear();
+		while ((read = fread(buffer, 1, sizeof(buffer), fp)) > 0)
+			nib.insert(nib.end(), buffer, buffer + read);
+		fclose(fp);
+		return nib.size() > 0x100 && memcmp(&nib[0], "MNIB-1541-RAW", 13) == 0;
+	}
+
+	unsigned random = 1;
+	nib.assign(0x100, 0);
+	memcpy(&nib[0], "MNIB-1541-RAW\1", 14);
+	for (int trackNumber = 1; trackNumber <= 35; ++trackNumber)
+	{
+		int density = trackNumber < 18 ? 3 : trackNumber < 25 ? 2 : trackNumber < 31 ? 1 : 0;
+		int sectors = 17 + density + (density == 3);
+		std::vector<unsigned char> track;
+
+		nib[0x10 + (trackNumber - 1) * 2] = trackNumber * 2;
+		nib[0x11 + (trackNumber - 1) * 2] = density;
+		for (int sector = 0; sector < sectors; ++sector)
+		{
+			unsigned char header[8] = { 0x08, 0, (unsigned char)sector, (unsigned char)trackNumber, '0', '1', 0x0f, 0x0f };
+			unsigned char block[260] = { 0x07 };
+
+			header[1] = header[2] ^ header[3] ^ header[4] ^ header[5];
+			// About half the blocks hold file data, the rest are still as the format left them.
+			random = random * 1103515245 + 12345;
+			bool used = (random >> 16) & 1;
+			for (int i = 1; i <= 256; ++i)
+			{
+				random = random * 1103515245 + 12345;
+				block[i] = used ? (unsigned char)(random >> 16) & ((random >> 24) & 3 ? 0x7f : 0xff) : i == 1 ? 0x01 : 0;
+				block[257] ^= block[i];
+			}
+			NIBAppend(track, 0xff, 5);
+			NIBAppendGCR(track, header, sizeof(header));
+			NIBAppend(track, 0x55, 9);
+			NIBAppend(track, 0xff, 5);
+			NIBAppendGCR(track, block, sizeof(block));
+			NIBAppend(track, 0x55, 8);
+		}
+		size_t length = track.size();
+		while (track.size() < NIB_TRACK_LENGTH)
+			track.push_back(track[track.size() - length]);
+		nib.insert(nib.end(), track.begin(), track.begin() + NIB_TRACK_LENGTH);
+	}
+	return true;
+}
+
+#endif
@@ -0,0 +1,248 @@
+// Times Screen::Clear, DrawRectangle and PlotImage against the pixel at a time versions they replaced
+// (a bounds check and a call through plotPixelFn for every pixel) in each colour depth, after checking that both draw the same.
+// The real Screen::Open is run against a stand in for the GPU's mailbox that hands out a buffer in this program.
+//	screen_bench
+
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <time.h>
+#include "Screen.h"
+extern "C"
+{
+	#include "rpi-mailbox-interface.h"
+}
+
+#define WIDTH 1024
+#define HEIGHT 720
+#define ICON_SIZE 64
+
+unsigned char* CBMFont = 0;
+u32 RPi_CpuId;
+
+// The GPU's framebuffer. The mailbox hands out its address in 30 bits so the program is built without PIE.
+static unsigned char gpuPages[WIDTH * HEIGHT * 4 * 2];
+static u32 gpuDepth;
+static rpi_mailbox_property_t property;
+
+extern "C" void RPI_PropertyInit(void)
+{
+}
+
+extern "C" void RPI_PropertyAddTag(rpi_mailbox_tag_t tag, ...)
+{
+	if (tag == TAG_SET_DEPTH)
+	{
+		va_list args;
+		va_start(args, tag);
+		gpuDepth = va_arg(args, u32);
+		va_end(args);
+	}
+}
+
+extern "C" int RPI_PropertyProcess(void)
+{
+	return 0;
+}
+
+extern "C" rpi_mailbox_property_t* RPI_PropertyGet(rpi_mailbox_tag_t tag)
+{
+	property.tag = tag;
+	switch (tag)
+	{
+		case TAG_GET_PHYSICAL_SIZE:
+			property.data.buffer_32[0] = WIDTH;
+			property.data.buffer_32[1] = HEIGHT;
+		break;
+		case TAG_GET_VIRTUAL_SIZE:
+			property.data.buffer_32[0] = WIDTH;
+			property.data.buffer_32[1] = HEIGHT * 2;
+		break;
+		case TAG_GET_DEPTH:
+			property.data.buffer_32[0] = gpuDepth;
+		break;
+		case TAG_GET_PITCH:
+			property.data.buffer_32[0] = WIDTH * (gpuDepth >> 3);
+		break;
+		case TAG_ALLOCATE_BUFFER:
+			property.data.buffer_32[0] = (int)(size_t)gpuPages;
+		break;
+		default:
+			return 0;
+	}
+	return &property;
+}
+
+// How Screen drew before: everything went through PlotPixel or the plotPixelFn for the depth.
+class PixelScreen
+{
+public:
+	PixelScreen(unsigned char* framebuffer, u32 bpp)
+		: framebuffer(framebuffer)
+		, bpp(bpp)
+		, pitch(WIDTH * (bpp >> 3))
+	{
+		switch (bpp)
+		{
+			case 32:
+				plotPixelFn = &PixelScreen::PlotPixel32;
+			break;
+			case 24:
+				plotPixelFn = &PixelScreen::PlotPixel24;
+			break;
+			case 16:
+				plotPixelFn = &PixelScreen::PlotPixel16;
+			break;
+			default:
+				plotPixelFn = &PixelScreen::PlotPixel8;
+			break;
+		}
+	}
+
+	void DrawRectangle(u32 x1, u32 y1, u32 x2, u32 y2, RGBA colour)
+	{
+		if (x2 > WIDTH)
+			x2 = WIDTH;
+		if (y2 > HEIGHT)
+			y2 = HEIGHT;
+
+		for (u32 y = y1; y < y2; y++)
+		{
+			u32 line = y * pitch;
+			for (u32 x = x1; x < x2; x++)
+			{
+				u32 pixel_offset = (x * (bpp >> 3)) + line;
+				(this->*plotPixelFn)(pixel_offset, colour);
+			}
+		}
+	}
+
+	void Clear(RGBA colour)
+	{
+		DrawRectangle(0, 0, WIDTH, HEIGHT, colour);
+	}
+
+	void PlotPixel(u32 x, u32 y, RGBA colour)
+	{
+		if (x >= WIDTH || y >= HEIGHT)
+			return;
+		int pixel_offset = (x * (bpp >> 3)) + (y * pitch);
+		(this->*plotPixelFn)(pixel_offset, colour);
+	}
+
+	void PlotImage(u32* image, int x, int y, int w, int h)
+	{
+		int i = 0;
+		for (int py = 0; py < h; ++py)
+		{
+			for (int px = 0; px < w; ++px)
+				PlotPixel(x + px, y + py, image[i++]);
+		}
+	}
+
+private:
+	typedef void (PixelScreen::*PlotPixelFunction)(u32 pixel_offset, RGBA Colour);
+
+	void PlotPixel32(u32 pixel_offset, RGBA Colour)
+	{
+		*((volatile RGBA*)&framebuffer[pixel_offset]) = Colour;
+	}
+	void PlotPixel24(u32 pixel_offset, RGBA Colour)
+	{
+		framebuffer[pixel_offset++] = BLUE(Colour);
+		framebuffer[pixel_offset++] = GREEN(Colour);
+		framebuffer[pixel_offset++] = RED(Colour);
+	}
+	void PlotPixel16(u32 pixel_offset, RGBA Colour)
+	{
+		*(unsigned short*)&framebuffer[pixel_offset] = ((RED(Colour) >> 3) << 11) | ((GREEN(Colour) >> 2) << 5) | (BLUE(Colour) >> 3);
+	}
+	void PlotPixel8(u32 pixel_offset, RGBA Colour)
+	{
+		framebuffer[pixel_offset++] = RED(Colour);
+	}
+
+	unsigned char* framebuffer;
+	u32 bpp;
+	u32 pitch;
+	PlotPixelFunction plotPixelFn;
+};
+
+static unsigned char pixelFramebuffer[WIDTH * HEIGHT * 4];
+static u32 icon[ICON_SIZE * ICON_SIZE];
+
+static double Now()
+{
+	timespec time;
+	clock_gettime(CLOCK_MONOTONIC, &time);
+	return time.tv_sec + time.tv_nsec * 1e-9;
+}
+
+// Draws the same things with either.
+template <typename SCREEN>
+static void Draw(SCREEN& screen, int operation, int index)
+{
+	switch (operation)
+	{
+		case 0:
+			screen.Clear(RGBA(index, 0x40, 0x80, 0xff));
+		break;
+		case 1:
+			screen.DrawRectangle((index * 37) % WIDTH, (index * 11) % HEIGHT, (index * 37) % WIDTH + 200, (index * 11) % HEIGHT + 100, RGBA(0x20, index, 0x60, 0xff));
+		break;
+		default:
+			screen.PlotImage(icon, (index * 37) % (WIDTH + ICON_SIZE) - ICON_SIZE / 2, (index * 11) % (HEIGHT + ICON_SIZE) - ICON_SIZE / 2, ICON_SIZE, ICON_SIZE);
+		break;
+	}
+}
+
+int main()
+{
+	static const u32 depths[] = { 32, 24, 16, 8 };
+	static const char* operations[] = { "Clear", "DrawRectangle 200x100", "PlotImage 64x64" };
+	static const int repeats[] = { 50, 5000, 20000 };
+	bool same = true;
+
+	for (int i = 0; i < ICON_SIZE * ICON_SIZE; ++i)
+		icon[i] = i * 2654435761u;
+
+	for (u32 depth = 0; depth < sizeof(depths) / sizeof(depths[0]); ++depth)
+	{
+		u32 bpp = depths[depth];
+		u32 bytes = WIDTH * HEIGHT * (bpp >> 3);
+		Screen screen;
+		PixelScreen pixelScreen(pixelFramebuffer, bpp);
+
+		// Until the compositor is enabled everything drawn is copied to the first page straight away.
+		screen.Open(WIDTH, HEIGHT, bpp);
+		memset(pixelFramebuffer, 0, sizeof(pixelFramebuffer));
+		for (int index = 0; index < 300; ++index)
+		{
+			Draw(screen, index % 3 ? 1 + (index & 1) : index % 9 ? 2 : 0, index);
+			Draw(pixelScreen, index % 3 ? 1 + (index & 1) : index % 9 ? 2 : 0, index);
+		}
+		if (memcmp(gpuPages, pixelFramebuffer, bytes) != 0)
+		{
+			printf("%ubpp: Screen and the pixel at a time drawing differ\n", bpp);
+			same = false;
+		}
+
+		// Then drawing only marks tiles for the compositor, as it does once the emulator is running.
+		screen.EnableCompositor();
+		for (int operation = 0; operation < 3; ++operation)
+		{
+			double start = Now();
+			for (int index = 0; index < repeats[operation]; ++index)
+				Draw(pixelScreen, operation, index);
+			double pixel = (Now() - start) / repeats[operation];
+
+			start = Now();
+			for (int index = 0; index < repeats[operation]; ++index)
+				Draw(screen, operation, index);
+			double span = (Now() - start) / repeats[operation];
+
+			printf("%2ubpp %-22s pixel at a time %9.2f us  spans %8.2f us  (%.1fx)\n", bpp, operations[operation], pixel * 1e6, span * 1e6, pixel / span);
+		}
+	}
+	return same ? 0 : 1;
+}
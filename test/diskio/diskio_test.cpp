@@ -0,0 +1,206 @@
+// Checks the USB read ahead and write gathering in src/diskio.cpp against a simulated mass storage device
+// that records every transfer; the sectors seen through disk_read() must always be those last written,
+// and the device must hold everything written once FatFs syncs.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include "ff.h"
+#include "diskio.h"
+
+#define SECTOR_SIZE 512
+#define SECTORS 4096
+#define DRIVE 1	// (the first USB device)
+
+struct Transfer
+{
+	bool write;
+	unsigned sector;
+	unsigned count;
+};
+
+static unsigned char device[SECTORS * SECTOR_SIZE];
+static unsigned char written[SECTORS * SECTOR_SIZE];	// What FatFs has written so far
+static std::vector<Transfer> transfers;
+static int fails;
+
+extern "C" int USPiMassStorageDeviceRead(unsigned long long offset, void* buffer, unsigned count, unsigned deviceIndex)
+{
+	Transfer transfer = { false, (unsigned)(offset / SECTOR_SIZE), count / SECTOR_SIZE };
+	transfers.push_back(transfer);
+	if (deviceIndex != 0 || offset + count > sizeof(device))
+		return -1;
+	memcpy(buffer, device + offset, count);
+	return count;
+}
+
+extern "C" int USPiMassStorageDeviceWrite(unsigned long long offset, const void* buffer, unsigned count, unsigned deviceIndex)
+{
+	Transfer transfer = { true, (unsigned)(offset / SECTOR_SIZE), count / SECTOR_SIZE };
+	transfers.push_back(transfer);
+	if (deviceIndex != 0 || offset + count > sizeof(device))
+		return -1;
+	memcpy(device + offset, buffer, count);
+	return count;
+}
+
+// Only the USB path is tested.
+bool CEMMCDevice::Initialize() { return false; }
+int CEMMCDevice::DoRead(u8* buf, size_t buf_size, u32 block_no) { return 0; }
+int CEMMCDevice::DoWrite(u8* buf, size_t buf_size, u32 block_no) { return 0; }
+
+static void Check(bool ok, const char* test, const char* what)
+{
+	if (!ok)
+	{
+		printf("%s: %s\n", test, what);
+		fails++;
+	}
+}
+
+static void CheckTransfers(const char* test, const Transfer* expected, unsigned count)
+{
+	bool same = transfers.size() == count;
+	for (unsigned index = 0; same && index < count; ++index)
+		same = transfers[index].write == expected[index].write && transfers[index].sector == expected[index].sector && transfers[index].count == expected[index].count;
+	if (!same)
+	{
+		printf("%s: transfers were", test);
+		for (unsigned index = 0; index < transfers.size(); ++index)
+			printf(" %c%u+%u", transfers[index].write ? 'w' : 'r', transfers[index].sector, transfers[index].count);
+		printf("\n");
+		fails++;
+	}
+	transfers.clear();
+}
+
+static void Write(unsigned sector, unsigned count)
+{
+	static unsigned char data[128 * SECTOR_SIZE];
+	for (unsigned index = 0; index < count * SECTOR_SIZE; ++index)
+		data[index] = rand();
+	memcpy(written + sector * SECTOR_SIZE, data, count * SECTOR_SIZE);
+	Check(disk_write(DRIVE, data, sector, count) == RES_OK, "write", "failed");
+}
+
+static void Read(unsigned sector, unsigned count)
+{
+	static unsigned char data[128 * SECTOR_SIZE];
+	Check(disk_read(DRIVE, data, sector, count) == RES_OK, "read", "failed");
+	Check(memcmp(data, written + sector * SECTOR_SIZE, count * SECTOR_SIZE) == 0, "read", "did not get what was last written");
+}
+
+static void Sync()
+{
+	Check(disk_ioctl(DRIVE, CTRL_SYNC, 0) == RES_OK, "sync", "failed");
+	Check(memcmp(device, written, sizeof(device)) == 0, "sync", "the device does not hold what was written");
+}
+
+int main()
+{
+	for (unsigned index = 0; index < sizeof(device); ++index)
+		device[index] = written[index] = rand();
+
+	// Small sequential reads come from a read ahead run that doubles in size.
+	{
+		Read(100, 1);
+		for (unsigned sector = 101; sector < 108; ++sector)
+			Read(sector, 1);
+		Read(108, 1);
+		Read(123, 1);	// (still in the run read at 108)
+		const Transfer expected[] = { { false, 100, 8 }, { false, 108, 16 } };
+		CheckTransfers("read ahead", expected, 2);
+
+		Read(2000, 2);	// Not sequential so back to the smallest run
+		const Transfer restart[] = { { false, 2000, 8 } };
+		CheckTransfers("read ahead restart", restart, 1);
+
+		Read(SECTORS - 3, 3);	// A run would go off the end of the device
+		const Transfer end[] = { { false, SECTORS - 3, 8 }, { false, SECTORS - 3, 3 } };
+		CheckTransfers("read ahead at the end of the device", end, 2);
+	}
+
+	// Consecutive writes are held back until a sync.
+	{
+		for (unsigned sector = 300; sector < 310; ++sector)
+			Write(sector, 1);
+		CheckTransfers("gathering writes", 0, 0);
+		Sync();
+		const Transfer expected[] = { { true, 300, 10 } };
+		CheckTransfers("sync", expected, 1);
+
+		Sync();
+		CheckTransfers("sync with nothing gathered", 0, 0);
+	}
+
+	// Writing somewhere else sends what was gathered.
+	{
+		Write(400, 2);
+		Write(402, 1);
+		Write(500, 1);
+		Write(499, 1);	// (before the gathered run is not after it)
+		const Transfer expected[] = { { true, 400, 3 }, { true, 500, 1 } };
+		CheckTransfers("writing somewhere else", expected, 2);
+		Sync();
+		const Transfer synced[] = { { true, 499, 1 } };
+		CheckTransfers("writing somewhere else then sync", synced, 1);
+	}
+
+	// Reading sends what was gathered first (even if the read does not overlap it).
+	{
+		Write(600, 4);
+		Read(1500, 1);
+		const Transfer expected[] = { { true, 600, 4 }, { false, 1500, 8 } };
+		CheckTransfers("reading", expected, 2);
+		Sync();
+		CheckTransfers("reading then sync", 0, 0);
+	}
+
+	// Writing into the read ahead run must not leave stale sectors to be read back.
+	{
+		Read(700, 1);
+		Write(703, 1);
+		Read(703, 1);
+		const Transfer expected[] = { { false, 700, 8 }, { true, 703, 1 }, { false, 703, 8 } };
+		CheckTransfers("writing into the read ahead run", expected, 3);
+	}
+
+	// No more than a full run is gathered, and big writes go straight out.
+	{
+		for (unsigned sector = 800; sector < 870; sector += 2)
+			Write(sector, 2);
+		const Transfer expected[] = { { true, 800, 64 } };
+		CheckTransfers("gathering a full run", expected, 1);
+		Write(1000, 64);
+		const Transfer big[] = { { true, 864, 6 }, { true, 1000, 64 } };
+		CheckTransfers("a big write", big, 2);
+		Sync();
+		CheckTransfers("a big write then sync", 0, 0);
+	}
+
+	// Anything FatFs might do, against the simple model.
+	for (int step = 0; step < 20000; ++step)
+	{
+		int operation = rand() % 10;
+		unsigned count = 1 + rand() % (rand() % 4 == 0 ? 100 : 8);
+		unsigned sector = rand() % 3 ? 1000 + rand() % (200 - count + 1) : rand() % (SECTORS - count);
+
+		if (operation < 5)
+			Read(sector, count);
+		else if (operation < 9)
+			Write(sector, count);
+		else
+			Sync();
+		transfers.clear();
+		if (fails)
+		{
+			printf("random accesses: failed at step %d\n", step);
+			break;
+		}
+	}
+	Sync();
+
+	printf("diskio_test: %d failed\n", fails);
+	return fails != 0;
+}
@@ -0,0 +1,139 @@
+// Runs src/m6522.cpp (which lets its timers count on their own until something needs them)
+// cycle for cycle against m6522_eager (which updates everything every cycle) with pseudo random register accesses,
+// control line edges and port input, from a busy CPU to an idle one.
+// Reads, the IRQ line, the port B output, CA2, CB2 and (now and then) every register must always match.
+
+#include <stdio.h>
+#include "m6522.h"
+#include "m6522_eager.h"
+
+static const int SEEDS = 400;
+static const int CYCLES_PER_SEED = 200000;
+
+static unsigned randomState;
+
+static unsigned Random()
+{
+	randomState = randomState * 1103515245 + 12345;
+	return (randomState >> 16) & 0x7fff;
+}
+
+int main()
+{
+	int fails = 0;
+
+	for (int seed = 1; seed <= SEEDS; ++seed)
+	{
+		Interrupt irq;
+		Interrupt irqEager;
+		m6522 via;
+		m6522_eager viaEager;
+
+		randomState = seed;
+		via.ConnectIRQ(&irq);
+		viaEager.ConnectIRQ(&irqEager);
+		via.Reset();
+		viaEager.Reset();
+
+		int busy = seed % 4;	// How often the CPU looks at the VIA
+		int period = busy == 0 ? 5 : busy == 1 ? 50 : busy == 2 ? 2000 : 20000;
+		bool shiftModes = (seed / 4) % 3 != 0;
+
+		for (int cycle = 0; cycle < CYCLES_PER_SEED; ++cycle)
+		{
+			unsigned value = Random();
+
+			if (value % period == 0)
+			{
+				unsigned reg = Random() & 15;
+				unsigned char data = Random();
+
+				if (!shiftModes && reg == 11)
+					data &= 0xe3;
+				if ((reg == 4 || reg == 5 || reg == 8 || reg == 9) && (Random() & 1))
+					data &= 0x0f;	// (short timers)
+
+				if (Random() & 1)
+				{
+					via.Write(reg, data);
+					viaEager.Write(reg, data);
+				}
+				else
+				{
+					unsigned char read = via.Read(reg);
+					unsigned char readEager = viaEager.Read(reg);
+					if (read != readEager)
+					{
+						printf("seed %d cycle %d reading register %u got %02x instead of %02x\n", seed, cycle, reg, read, readEager);
+						fails++;
+						break;
+					}
+				}
+			}
+
+			unsigned edges = value >> 8;
+			if (edges % 97 == 0)
+			{
+				bool level = Random() & 1;
+				via.InputCA1(level);
+				viaEager.InputCA1(level);
+			}
+			if (edges % 89 == 0)
+			{
+				bool level = Random() & 1;
+				via.InputCB1(level);
+				viaEager.InputCB1(level);
+			}
+			if (edges % 83 == 0)
+			{
+				bool level = Random() & 1;
+				via.InputCA2(level);
+				viaEager.InputCA2(level);
+			}
+			if (edges % 79 == 0)
+			{
+				bool level = Random() & 1;
+				via.InputCB2(level);
+				viaEager.InputCB2(level);
+			}
+			if (edges % 71 == 0)
+			{
+				unsigned char input = Random();
+				via.GetPortB()->SetInput(input);
+				viaEager.GetPortB()->SetInput(input);
+			}
+
+			via.Execute();
+			viaEager.Execute();
+
+			if (irq.IsAsserted() != irqEager.IsAsserted() || via.GetPortB()->GetOutput() != viaEager.GetPortB()->GetOutput()
+				|| via.GetCA2() != viaEager.GetCA2() || via.GetCB2() != viaEager.GetCB2())
+			{
+				printf("seed %d cycle %d IRQ or output lines differ\n", seed, cycle);
+				fails++;
+				break;
+			}
+
+			if ((cycle % 50000) == 49999)
+			{
+				int reg;
+				for (reg = 0; reg < 16; ++reg)
+				{
+					if (via.Peek(reg) != viaEager.Peek(reg))
+					{
+						printf("seed %d cycle %d register %d is %02x instead of %02x\n", seed, cycle, reg, via.Peek(reg), viaEager.Peek(reg));
+						break;
+					}
+				}
+				if (reg != 16)
+				{
+					fails++;
+					break;
+				}
+			}
+		}
+	}
+
+	printf("via_test: %d of %d runs failed\n", fails, SEEDS);
+	return fails != 0;
+}
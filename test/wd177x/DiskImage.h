@@ -0,0 +1,79 @@
+// Stands in for src/DiskImage.h so the WD177x can be run on the host.
+// Every track has ten 512 byte sectors (with a fixed pattern of data) and one byte per MFM byte time.
+
+#ifndef DISKIMAGE_H
+#define DISKIMAGE_H
+
+#include <string.h>
+
+static const unsigned short D81_SECTOR_LENGTH = 512;
+
+class DiskImage
+{
+public:
+	enum
+	{
+		TRACKS = 80,
+		TRACK_LENGTH = 6200
+	};
+
+	DiskImage() : readOnly(false)
+	{
+		unsigned seed = 12345;
+
+		memset(bytes, 0x4e, sizeof(bytes));
+		memset(sync, 0, sizeof(sync));
+		for (int track = 0; track < TRACKS; ++track)
+		{
+			for (int head = 0; head < 2; ++head)
+			{
+				unsigned char* data = bytes[track][head];
+				int position = 32;
+				for (int sector = 1; sector <= 10; ++sector)
+				{
+					position += 12;	// (zeros)
+					memset(data + position - 12, 0, 12);
+					for (int index = 0; index < 3; ++index)
+					{
+						sync[track][head][position] = 1;
+						data[position++] = 0xa1;
+					}
+					data[position++] = 0xfe;
+					data[position++] = track;
+					data[position++] = head;
+					data[position++] = sector;
+					data[position++] = 2;
+					data[position++] = 0x12;
+					data[position++] = 0x34;
+					position += 22 + 12;
+					memset(data + position - 12, 0, 12);
+					for (int index = 0; index < 3; ++index)
+					{
+						sync[track][head][position] = 1;
+						data[position++] = 0xa1;
+					}
+					data[position++] = 0xfb;
+					for (int index = 0; index < D81_SECTOR_LENGTH; ++index)
+					{
+						seed = seed * 1103515245 + 12345;
+						data[position++] = seed >> 16;
+					}
+					position += 2 + 35;
+				}
+			}
+		}
+	}
+
+	unsigned TrackLength(unsigned track) const { return TRACK_LENGTH; }
+	unsigned char GetD81Byte(unsigned track, unsigned head, unsigned position) const { return bytes[track][head][position]; }
+	void SetD81Byte(unsigned track, unsigned head, unsigned position, unsigned char data) { bytes[track][head][position] = data; }
+	bool IsD81ByteASync(unsigned track, unsigned head, unsigned position) const { return sync[track][head][position]; }
+	bool GetReadOnly() const { return readOnly; }
+	static void CRC(unsigned short& runningCRC, unsigned char data) { runningCRC = (runningCRC << 8) ^ (runningCRC >> 8) ^ data; }
+
+	unsigned char bytes[TRACKS][2][TRACK_LENGTH + 1];
+	unsigned char sync[TRACKS][2][TRACK_LENGTH + 1];
+	bool readOnly;
+};
+
+#endif
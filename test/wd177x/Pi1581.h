@@ -0,0 +1 @@
+// Stands in for src/Pi1581.h (the WD177x does not need anything from it).
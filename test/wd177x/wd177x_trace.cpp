@@ -0,0 +1,215 @@
+// Drives the WD177x with a pseudo random stream of commands and register accesses (from a busy polling loop to an idle drive)
+// and traces every register read and every change the CPU could see (status, track, sector and data registers, IRQ and pins).
+// Given a trace file (reference.trace, recorded with the cycle at a time implementation) it stops at the first line that differs,
+// otherwise it prints the trace.
+
+#include <stdio.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <new>
+#include "wd177x.h"
+
+extern "C" void log_ring_write(int num_args, const char* format, ...)
+{
+}
+
+static const int SEEDS = 6;
+static const int STEPS_PER_SEED = 250000;	// Of 4 cycles at 8MHz (one 6502 cycle)
+
+static unsigned randomState;
+static FILE* reference;
+static unsigned traceLine;
+
+static void Trace(const char* format, ...)
+{
+	char line[128];
+	char expected[128];
+	va_list args;
+
+	va_start(args, format);
+	vsnprintf(line, sizeof(line), format, args);
+	va_end(args);
+
+	traceLine++;
+	if (!reference)
+	{
+		fputs(line, stdout);
+		return;
+	}
+	if (!fgets(expected, sizeof(expected), reference))
+		strcpy(expected, "(the end of the trace)\n");
+	if (strcmp(line, expected))
+	{
+		printf("wd177x_trace: line %u differs\n  expected %s  got      %s", traceLine, expected, line);
+		exit(1);
+	}
+}
+
+static unsigned Random()
+{
+	randomState = randomState * 1103515245 + 12345;
+	return (randomState >> 16) & 0x7fff;
+}
+
+struct State
+{
+	bool irq;
+	bool ip;
+	bool tr00;
+	unsigned track;
+	unsigned char registers[4];
+
+	bool operator!=(const State& other) const
+	{
+		return irq != other.irq || ip != other.ip || tr00 != other.tr00 || track != other.track || memcmp(registers, other.registers, sizeof(registers));
+	}
+};
+
+static State GetState(WD177x& fdc, Interrupt& irq)
+{
+	State state;
+	state.irq = irq.IsAsserted();
+	state.ip = fdc.GetIPPin();
+	state.tr00 = fdc.GetTR00Pin();
+	state.track = fdc.GetCurrentTrack();
+	for (unsigned reg = 0; reg < 4; ++reg)
+		state.registers[reg] = fdc.Peek(reg);
+	return state;
+}
+
+static void Execute(WD177x& fdc, unsigned cycles, bool batched)
+{
+#if !defined(WD177X_CYCLE_AT_A_TIME)	// (how reference.trace was recorded)
+	if (batched)
+	{
+		fdc.Execute(cycles);
+		return;
+	}
+#endif
+	while (cycles--)
+		fdc.Execute();
+}
+
+int main(int argc, char** argv)
+{
+	static const unsigned char commands[] = { 0x00, 0x10, 0x20, 0x30, 0x44, 0x54, 0x60, 0x70, 0x03, 0x80, 0x84, 0x90, 0xa0, 0xa4, 0xb0, 0xc0, 0xe0, 0xf0, 0xd0, 0xd8, 0xd4, 0x08, 0x0c };
+	static DiskImage diskImage;
+
+	if (argc > 1)
+	{
+		reference = fopen(argv[1], "r");
+		if (!reference)
+		{
+			printf("wd177x_trace: cannot open %s\n", argv[1]);
+			return 1;
+		}
+	}
+
+	for (int seed = 1; seed <= SEEDS; ++seed)
+	{
+		Interrupt irq;
+		// Zeroed like the global the emulator uses.
+		WD177x* fdc = new (calloc(1, sizeof(WD177x))) WD177x;
+		unsigned lastCommand = 0;
+
+		randomState = seed;
+		new (&diskImage) DiskImage;
+		fdc->ConnectIRQ(&irq);
+		fdc->Reset();
+		fdc->Insert(&diskImage);
+
+		int busy = seed % 3;
+		int period = busy == 0 ? 20 : busy == 1 ? 400 : 20000;
+		State last = GetState(*fdc, irq);
+
+		Trace("seed %d busy %d\n", seed, busy);
+		for (int step = 0; step < STEPS_PER_SEED; ++step)
+		{
+			unsigned value = Random();
+
+			if (value % period == 0)
+			{
+				int operation = Random() % 10;
+				if (busy == 0 && operation < 4)
+					operation = 9;
+
+				if (operation == 9 && !(fdc->Peek(0) & 1))
+				{
+					// Read or write a sector on the current track.
+					static const unsigned char sectorCommands[] = { 0x80, 0xa0, 0x90, 0xc0 };
+					unsigned char track = fdc->GetCurrentTrack();
+					unsigned char sector = 1 + Random() % 10;
+					lastCommand = sectorCommands[Random() & 3];
+					fdc->Write(1, track);
+					fdc->Write(2, sector);
+					fdc->Write(0, lastCommand);
+				}
+				else if (operation == 0)
+				{
+					fdc->Write(3, Random() % 80);
+					lastCommand = commands[Random() % sizeof(commands)] | (Random() & 3);
+					fdc->Write(0, lastCommand);
+				}
+				else if (operation == 1)
+				{
+					unsigned reg = 1 + Random() % 3;
+					fdc->Write(reg, reg == 2 ? 1 + Random() % 10 : Random() % 80);
+				}
+				else if (operation == 2)
+				{
+					fdc->AssertExternalMotor(Random() & 1);
+				}
+				else if (operation == 3)
+				{
+					fdc->SetSide(Random() & 1);
+				}
+				else
+				{
+					unsigned reg = Random() & 3;
+					Trace("%d R%u %02x\n", step, reg, fdc->Read(reg));
+				}
+			}
+
+			// A polling loop servicing DRQ.
+			if (busy == 0 && (value >> 8) % 7 == 0 && (fdc->Peek(0) & 2))
+			{
+				if ((lastCommand & 0xe0) == 0xa0 && (Random() & 1))
+					fdc->Write(3, Random());
+				else
+					Trace("%d R3 %02x\n", step, fdc->Read(3));
+			}
+
+			Execute(*fdc, 4, (value >> 4) & 1);
+
+			State state = GetState(*fdc, irq);
+			if (state != last)
+			{
+				Trace("%d irq %d ip %d tr00 %d track %u %02x %02x %02x %02x\n", step, state.irq, state.ip, state.tr00, state.track,
+					state.registers[0], state.registers[1], state.registers[2], state.registers[3]);
+				last = state;
+			}
+		}
+
+		// What was written to the disk.
+		unsigned hash = 0x811c9dc5;
+		const unsigned char* bytes = &diskImage.bytes[0][0][0];
+		for (unsigned index = 0; index < sizeof(diskImage.bytes); ++index)
+			hash = (hash ^ bytes[index]) * 16777619;
+		Trace("disk %08x\n", hash);
+
+		free(fdc);
+	}
+
+	if (reference)
+	{
+		char extra[128];
+		if (fgets(extra, sizeof(extra), reference))
+		{
+			printf("wd177x_trace: the trace stops short at line %u\n", traceLine);
+			return 1;
+		}
+		printf("wd177x_trace: %u lines match %s\n", traceLine, argv[1]);
+	}
+	return 0;
+}